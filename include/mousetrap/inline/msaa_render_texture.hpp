@@ -0,0 +1,30 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+namespace mousetrap
+{
+    template <typename Function_t, typename Data_t>
+    void MultisampledRenderTexture::download_async(Function_t f_in, Data_t data_in) const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::multisampled_render_texture_internal_resolve(_internal);
+        detail::texture_internal_download_framebuffer_async(_internal->intermediate_buffer, GL_COLOR_ATTACHMENT0, Vector2i(_internal->width, _internal->height), new std::function<void(const Image&)>([f = f_in, data = data_in](const Image& image){
+            f(image, data);
+        }));
+    }
+
+    template <typename Function_t>
+    void MultisampledRenderTexture::download_async(Function_t f_in) const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::multisampled_render_texture_internal_resolve(_internal);
+        detail::texture_internal_download_framebuffer_async(_internal->intermediate_buffer, GL_COLOR_ATTACHMENT0, Vector2i(_internal->width, _internal->height), new std::function<void(const Image&)>([f = f_in](const Image& image){
+            f(image);
+        }));
+    }
+}
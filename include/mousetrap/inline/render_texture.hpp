@@ -0,0 +1,28 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+namespace mousetrap
+{
+    template <typename Function_t, typename Data_t>
+    void RenderTexture::download_async(Function_t f_in, Data_t data_in) const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::texture_internal_download_framebuffer_async(_internal->framebuffer_handle, detail::RENDER_TEXTURE_ATTACHMENT, get_size(), new std::function<void(const Image&)>([f = f_in, data = data_in](const Image& image){
+            f(image, data);
+        }));
+    }
+
+    template <typename Function_t>
+    void RenderTexture::download_async(Function_t f_in) const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::texture_internal_download_framebuffer_async(_internal->framebuffer_handle, detail::RENDER_TEXTURE_ATTACHMENT, get_size(), new std::function<void(const Image&)>([f = f_in](const Image& image){
+            f(image);
+        }));
+    }
+}
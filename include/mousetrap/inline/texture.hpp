@@ -0,0 +1,30 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+namespace mousetrap
+{
+    template <typename Function_t, typename Data_t>
+    void Texture::download_async(Function_t f_in, Data_t data_in) const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::texture_internal_flush_updates(_internal);
+        detail::texture_internal_download_async(_internal->native_handle, *_internal->size, new std::function<void(const Image&)>([f = f_in, data = data_in](const Image& image){
+            f(image, data);
+        }));
+    }
+
+    template <typename Function_t>
+    void Texture::download_async(Function_t f_in) const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::texture_internal_flush_updates(_internal);
+        detail::texture_internal_download_async(_internal->native_handle, *_internal->size, new std::function<void(const Image&)>([f = f_in](const Image& image){
+            f(image);
+        }));
+    }
+}
@@ -0,0 +1,153 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#pragma once
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <vector>
+
+#include <mousetrap/color.hpp>
+#include <mousetrap/geometry.hpp>
+#include <mousetrap/gl_transform.hpp>
+#include <mousetrap/signal_emitter.hpp>
+
+namespace mousetrap
+{
+    /// @brief per-instance attributes of a shape rendered using an mousetrap::InstanceBuffer
+    struct Instance
+    {
+        /// @brief constructor
+        /// @param transform transform applied to the shapes vertices before the render tasks transform
+        /// @param color color multiplied with the shapes vertex colors
+        /// @param texture_rectangle region of the texture the shapes texture coordinates are mapped into, in relative texture coordinates
+        Instance(GLTransform transform = GLTransform(), RGBA color = RGBA(1, 1, 1, 1), Rectangle texture_rectangle = Rectangle{{0, 0}, {1, 1}})
+            : transform(transform), color(color), texture_rectangle(texture_rectangle)
+        {}
+
+        /// @brief transform applied to the shapes vertices, in gl coordinates
+        GLTransform transform;
+
+        /// @brief color multiplied with the shapes vertex colors
+        RGBA color;
+
+        /// @brief region of the texture the shapes texture coordinates are mapped into, {0, 0} is the top left of the texture
+        Rectangle texture_rectangle;
+    };
+
+    #ifndef DOXYGEN
+    class InstanceBuffer;
+    namespace detail
+    {
+        struct InstanceInfo
+        {
+            float _transform[16];
+            float _color[4];
+            float _texture_rectangle[4];
+        };
+
+        struct _InstanceBufferInternal
+        {
+            GObject parent;
+
+            std::vector<InstanceInfo>* instance_data;
+            GLNativeHandle buffer_id = 0;
+
+            uint64_t buffer_size = 0;
+            uint64_t dirty_first = 0;
+            uint64_t dirty_last = 0;
+
+            uint64_t version = 0;
+        };
+        using InstanceBufferInternal = _InstanceBufferInternal;
+        DEFINE_INTERNAL_MAPPING(InstanceBuffer);
+
+        /// @brief upload all instances modified since the last call, called automatically before rendering
+        void instance_buffer_internal_update(InstanceBufferInternal*);
+    }
+    #endif
+
+    /// @brief GPU-side array of per-instance attributes, attach to a mousetrap::Shape using mousetrap::Shape::set_instance_buffer to render the shape once per instance in a single draw call
+    /// @note if a custom vertex shader is used, it has to declare the instance attributes at the locations returned by mousetrap::Shader::get_instance_transform_location, mousetrap::Shader::get_instance_color_location and mousetrap::Shader::get_instance_texture_rectangle_location
+    class InstanceBuffer : public SignalEmitter
+    {
+        public:
+            /// @brief construct with 0 instances
+            InstanceBuffer();
+
+            /// @brief construct from a vector of instances
+            /// @param instances
+            InstanceBuffer(const std::vector<Instance>& instances);
+
+            /// @brief construct from internal, \for_internal_use_only
+            InstanceBuffer(detail::InstanceBufferInternal*);
+
+            /// @brief destructor, frees GPU-side memory
+            ~InstanceBuffer();
+
+            /// @brief copy ctor deleted
+            InstanceBuffer(const InstanceBuffer&) = delete;
+
+            /// @brief copy assignment deleted
+            InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+            /// @brief expose internal
+            NativeObject get_internal() const override;
+
+            /// @brief expose as GObject, \for_internal_use_only
+            operator NativeObject() const override;
+
+            /// @brief replace all instances
+            /// @param instances
+            void set_instances(const std::vector<Instance>& instances);
+
+            /// @brief overwrite a range of instances from a contiguous array, the buffer grows if the range exceeds the current number of instances
+            /// @param first index of the first instance to overwrite
+            /// @param data pointer to the first element of the array
+            /// @param n number of elements in the array
+            void set_instances(uint64_t first, const Instance* data, uint64_t n);
+
+            /// @brief overwrite the transforms of a range of instances from a contiguous array, the buffer grows if the range exceeds the current number of instances
+            /// @param first index of the first instance to overwrite
+            /// @param data pointer to the first element of the array
+            /// @param n number of elements in the array
+            void set_transforms(uint64_t first, const GLTransform* data, uint64_t n);
+
+            /// @brief overwrite the colors of a range of instances from a contiguous array, the buffer grows if the range exceeds the current number of instances
+            /// @param first index of the first instance to overwrite
+            /// @param data pointer to the first element of the array
+            /// @param n number of elements in the array
+            void set_colors(uint64_t first, const RGBA* data, uint64_t n);
+
+            /// @brief overwrite a single instance, does nothing if the index is out of bounds
+            /// @param index instance index
+            /// @param instance
+            void set_instance(uint64_t index, const Instance& instance);
+
+            /// @brief get a single instance, returns Instance() and prints a warning if the index is out of bounds
+            /// @param index instance index
+            /// @return instance
+            Instance get_instance(uint64_t index) const;
+
+            /// @brief change the number of instances, new instances are default initialized
+            /// @param n_instances
+            void resize(uint64_t n_instances);
+
+            /// @brief get the number of instances
+            /// @return number of instances
+            uint64_t get_n_instances() const;
+
+            /// @brief get native OpenGL handle of the buffer
+            /// @return handle
+            GLNativeHandle get_native_handle() const;
+
+        private:
+            void queue_update(uint64_t first, uint64_t last);
+
+            detail::InstanceBufferInternal* _internal = nullptr;
+    };
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
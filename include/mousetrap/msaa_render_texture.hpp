@@ -7,7 +7,9 @@
 #include <mousetrap/gl_common.hpp>
 #if MOUSETRAP_ENABLE_OPENGL_COMPONENT
 
+#include <mousetrap/texture.hpp>
 #include <mousetrap/texture_object.hpp>
+#include <mousetrap/render_target_pool.hpp>
 #include <mousetrap/signal_emitter.hpp>
 
 namespace mousetrap
@@ -31,9 +33,21 @@ namespace mousetrap
             GLNativeHandle msaa_color_buffer_texture = 0;
             GLNativeHandle intermediate_buffer = 0;
             GLNativeHandle screen_texture = 0;
+
+            detail::RenderTargetAllocation* msaa_allocation = nullptr;
+            detail::RenderTargetAllocation* screen_allocation = nullptr;
+            bool screen_texture_dirty = false;
+
+            // attachments rounded up to a bucket of mousetrap::RenderTargetPool, only used for render targets owned by mousetrap::RenderArea
+            bool bucketed = false;
+
+            uint64_t version = 0;
         };
         using MultisampledRenderTextureInternal = _MultisampledRenderTextureInternal;
         DEFINE_INTERNAL_MAPPING(MultisampledRenderTexture);
+
+        /// @brief resolve the multi-sampled buffer into screen_texture if it was rendered to since the last resolve, allocates screen_texture on first use
+        void multisampled_render_texture_internal_resolve(MultisampledRenderTextureInternal*);
     }
     #endif
 
@@ -61,17 +75,45 @@ namespace mousetrap
             /// @brief unbind for use as a texture, usually called automatically during mousetrap::Shape::render
             void unbind() const override;
 
+            /// @brief get version of the texture content, changes whenever the texture is re-allocated or rendered to
+            /// @return version
+            uint64_t get_version() const override;
+
             /// @brief make the textures framebuffer the current render buffer, anything rendered between this and mousetrap::MultisampledRenderTexture::unbind_as_render_target will appear in the textures buffer
             void bind_as_render_target() const;
 
             /// @brief unbind as render target, restores buffer that was active before mousetrap::MultisampledRenderTexture::bind_as_rendertarget was called
             void unbind_as_render_target() const;
 
-            /// @brief create as texture of given size with all pixels set to RGBA(0, 0, 0, 0)
+            /// @brief unbind as render target and resolve the anti-aliased image directly into the buffer that was active before mousetrap::MultisampledRenderTexture::bind_as_render_target was called. This skips the copy into the texture, which is only made once the texture is bound or downloaded
+            void unbind_as_render_target_and_resolve() const;
+
+            /// @brief resolve the anti-aliased image into the currently bound framebuffer, for example to present the last image again without re-rendering it
+            void resolve_to_current_render_target() const;
+
+            /// @brief download the anti-aliased image into a CPU-side image, this is an extremely costly operation
+            [[nodiscard]] Image download() const;
+
+            /// @brief concurrently download the anti-aliased image into a CPU-side image. The transfer is queued behind all pending rendering commands, once it is done, <tt>on_done</tt> will be called from the main loop
+            /// @param on_done lambda with signature <tt>(const Image&, Data_t) -> void</tt>
+            /// @param data arbitrary data
+            template<typename Function_t, typename Data_t>
+            void download_async(Function_t on_done, Data_t data) const;
+
+            /// @brief concurrently download the anti-aliased image into a CPU-side image. The transfer is queued behind all pending rendering commands, once it is done, <tt>on_done</tt> will be called from the main loop
+            /// @param on_done lambda with signature <tt>(const Image&) -> void</tt>
+            template<typename Function_t>
+            void download_async(Function_t on_done) const;
+
+            /// @brief create as texture of given size with all pixels set to RGBA(0, 0, 0, 0). Storage is taken from mousetrap::RenderTargetPool, so unused attachments of the same size are reused instead of allocating GPU memory
             /// @param width x-dimension
             /// @param height y-dimensino
             void create(uint64_t width, uint64_t height);
 
+            /// @brief get region of the underlying texture that holds the image, in relative texture coordinates
+            /// @return rectangle, {0, 0} is the top left of the texture. Always {{0, 0}, {1, 1}}, unless the texture is a render target owned by mousetrap::RenderArea
+            Rectangle get_texture_rectangle() const;
+
             /// @brief expose a gobject
             operator GObject*() const override;
 
@@ -81,4 +123,6 @@ namespace mousetrap
     };
 }
 
+#include "inline/msaa_render_texture.hpp"
+
 #endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
\ No newline at end of file
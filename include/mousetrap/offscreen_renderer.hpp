@@ -0,0 +1,99 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#pragma once
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <vector>
+
+#include <mousetrap/color.hpp>
+#include <mousetrap/image.hpp>
+#include <mousetrap/render_task.hpp>
+#include <mousetrap/render_texture.hpp>
+#include <mousetrap/signal_emitter.hpp>
+
+namespace mousetrap
+{
+    #ifndef DOXYGEN
+    class OffscreenRenderer;
+    namespace detail
+    {
+        struct _OffscreenRendererInternal
+        {
+            GObject parent;
+
+            RenderTexture* render_texture;
+            Vector2i size;
+            RGBA clear_color;
+        };
+        using OffscreenRendererInternal = _OffscreenRendererInternal;
+        DEFINE_INTERNAL_MAPPING(OffscreenRenderer);
+    }
+    #endif
+
+    /// @brief renders tasks into an image without needing a window or mousetrap::RenderArea. If no OpenGL context was initialized by a mousetrap::Application, a surfaceless EGL context is created, which works without a display, for example on a server using Mesa llvmpipe
+    class OffscreenRenderer : public SignalEmitter
+    {
+        public:
+            /// @brief construct, initializes the OpenGL context if necessary
+            /// @param width width of the resulting images, in pixels
+            /// @param height height of the resulting images, in pixels
+            OffscreenRenderer(uint64_t width, uint64_t height);
+
+            /// @brief construct from internal, \for_internal_use_only
+            OffscreenRenderer(detail::OffscreenRendererInternal*);
+
+            /// @brief destructor
+            ~OffscreenRenderer();
+
+            /// @brief copy ctor deleted
+            OffscreenRenderer(const OffscreenRenderer&) = delete;
+
+            /// @brief copy assignment deleted
+            OffscreenRenderer& operator=(const OffscreenRenderer&) = delete;
+
+            /// @brief expose internal
+            NativeObject get_internal() const override;
+
+            /// @brief expose as GObject, \for_internal_use_only
+            operator NativeObject() const override;
+
+            /// @brief initialize a headless OpenGL context, called automatically by the constructor if no context exists yet. Has no effect if a context already exists
+            /// @return true if rendering is possible, false otherwise
+            static bool initialize();
+
+            /// @brief change size of the resulting images
+            /// @param width
+            /// @param height
+            void resize(uint64_t width, uint64_t height);
+
+            /// @brief get size of the resulting images
+            /// @return size
+            Vector2i get_size() const;
+
+            /// @brief set color the image is cleared to before rendering, RGBA(0, 0, 0, 0) by default
+            /// @param color
+            void set_clear_color(RGBA color);
+
+            /// @brief get color the image is cleared to before rendering
+            /// @return color
+            RGBA get_clear_color() const;
+
+            /// @brief render tasks in order and download the result, this blocks until the GPU is done
+            /// @param tasks
+            /// @return image, oriented such that it looks the same as if the tasks were rendered by a mousetrap::RenderArea
+            Image render(const std::vector<RenderTask>& tasks);
+
+            /// @brief get the render texture the tasks are rendered into, its content is valid after mousetrap::OffscreenRenderer::render returns
+            /// @return render texture
+            RenderTexture& get_render_texture() const;
+
+        private:
+            detail::OffscreenRendererInternal* _internal = nullptr;
+    };
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
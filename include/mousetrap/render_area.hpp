@@ -11,6 +11,14 @@
 #include <mousetrap/shape.hpp>
 #include <mousetrap/render_task.hpp>
 
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
 #ifdef DOXYGEN
     #include "../../docs/doxygen.inl"
 #endif
@@ -28,29 +36,200 @@ namespace mousetrap
         /// @brief free the global OpenGL context
         void shutdown_opengl();
 
-        /// @brief get whether gl context is disabled
-        bool is_opengl_disabled();
+        /// @brief whether the global context was created without a display by mousetrap::OffscreenRenderer, in which case mousetrap::detail::GL_CONTEXT is nullptr
+        inline bool GL_CONTEXT_IS_HEADLESS = false;
+
+        /// @brief initialize the global OpenGL context as a surfaceless EGL context, does not require a display. Does nothing if the context was already initialized
+        /// @return true if a usable context is available afterwards
+        bool initialize_opengl_headless();
+
+        /// @brief make the headless context current, \for_internal_use_only
+        void make_headless_opengl_context_current();
+
+        /// @brief make the global OpenGL context current, regardless of whether it is headless
+        void make_opengl_context_current();
     }
 
+    /// @brief workload and timing of a single draw issued by mousetrap::RenderArea, which is either one render task or a batch of tasks merged into one draw call
+    struct RenderTaskStatistics
+    {
+        /// @brief tasks drawn, more than one if the tasks were batched
+        std::vector<RenderTask> tasks;
+
+        /// @brief number of draw calls issued
+        uint64_t n_draw_calls = 0;
+
+        /// @brief number of vertices submitted, counting each index and each instance
+        uint64_t n_vertices = 0;
+
+        /// @brief number of bytes of vertex, index, instance and texture data uploaded
+        uint64_t n_bytes_uploaded = 0;
+
+        /// @brief time spent on the CPU, in milliseconds
+        double cpu_ms = 0;
+
+        /// @brief time spent on the GPU, in milliseconds, -1 if GPU timing is disabled
+        double gpu_ms = -1;
+    };
+
+    /// @brief workload and timing of a single frame of mousetrap::RenderArea
+    struct FrameStatistics
+    {
+        /// @brief index of the frame, counting from the first frame statistics were collected for
+        uint64_t frame_index = 0;
+
+        /// @brief number of draw calls issued
+        uint64_t n_draw_calls = 0;
+
+        /// @brief number of vertices submitted, counting each index and each instance
+        uint64_t n_vertices = 0;
+
+        /// @brief number of bytes of vertex, index, instance and texture data uploaded
+        uint64_t n_bytes_uploaded = 0;
+
+        /// @brief time spent on the CPU, in milliseconds
+        double cpu_ms = 0;
+
+        /// @brief time spent on the GPU, in milliseconds, -1 if GPU timing is disabled
+        double gpu_ms = -1;
+
+        /// @brief statistics of each draw, in the order they were issued
+        std::vector<RenderTaskStatistics> tasks;
+    };
+
     #ifndef DOXYGEN
     class RenderArea;
     class MultisampledRenderTexture;
+    class RenderTexture;
     namespace detail
     {
+        struct RenderQueueSortKey
+        {
+            GLNativeHandle program_id;
+            const void* texture;
+            int32_t blend_mode;
+            uint64_t sequence;
+            detail::RenderTaskInternal* task;
+
+            bool operator<(const RenderQueueSortKey& other) const;
+        };
+
+        // run of tasks in one layer that may be drawn in any order without changing the result
+        struct RenderQueueSegment
+        {
+            std::set<RenderQueueSortKey> tasks;
+
+            bool is_bounded = true;
+            Vector2f min = {0, 0};
+            Vector2f max = {0, 0};
+
+            bool has_common_blend_mode = true;
+            int32_t blend_mode = 0;
+        };
+
+        struct RenderQueueEntry
+        {
+            detail::RenderTaskInternal* task;
+            int32_t layer;
+            uint64_t sequence;
+
+            RenderQueueSortKey key;
+            uint64_t geometry_version;
+            std::list<RenderQueueSegment>::iterator segment;
+        };
+
+        struct SpatialIndexEntry
+        {
+            uint64_t geometry_version;
+            bool is_bounded;
+            bool is_oversized;
+
+            Vector2f min;
+            Vector2f max;
+
+            // range of grid cells the task was inserted into, inclusive
+            Vector2i cell_min;
+            Vector2i cell_max;
+        };
+
+        struct PendingFrameStatistics
+        {
+            FrameStatistics statistics;
+            std::chrono::steady_clock::time_point cpu_start;
+            GLStatistics counters_start;
+
+            // frame start, begin and end of each draw, frame end
+            std::vector<GLNativeHandle> timestamps;
+        };
+
+        struct FrameStatisticsScope
+        {
+            std::chrono::steady_clock::time_point cpu_start;
+            GLStatistics counters_start;
+        };
+
         struct _RenderAreaInternal
         {
             GObject parent;
             GtkGLArea* native;
-            std::vector<detail::RenderTaskInternal*>* tasks;
+
+            std::map<std::pair<int32_t, uint64_t>, RenderQueueEntry>* tasks;
+            std::unordered_multimap<detail::RenderTaskInternal*, std::pair<int32_t, uint64_t>>* task_to_key;
+            uint64_t task_sequence;
+
+            bool culling_enabled;
+
+            std::unordered_map<uint64_t, std::vector<detail::RenderTaskInternal*>>* spatial_cells;
+            std::unordered_map<detail::RenderTaskInternal*, SpatialIndexEntry>* spatial_entries;
+            std::vector<detail::RenderTaskInternal*>* spatial_oversized;
+
+            // tasks of the area by shape, and shapes that moved since the spatial index was last refreshed
+            std::unordered_multimap<detail::ShapeInternal*, detail::RenderTaskInternal*>* shape_to_tasks;
+            std::unordered_set<detail::ShapeInternal*>* spatial_moved;
+
+            bool sorting_enabled;
+            std::map<int32_t, std::list<RenderQueueSegment>>* sorted_layers;
+
+            // shapes whose tasks moved or changed their texture since the draw order was last updated, and the program version it was updated at
+            std::unordered_set<detail::ShapeInternal*>* sort_outdated;
+            uint64_t sort_program_version;
+            std::vector<detail::RenderTaskInternal*>* draw_order;
 
             bool apply_msaa;
             MultisampledRenderTexture* render_texture;
             Shape* render_texture_shape;
             RenderTask* render_texture_shape_task;
             Shader* render_texture_shader;
+
+            bool render_on_demand_enabled;
+            bool frame_cache_valid;
+            uint64_t frame_cache_version;
+            RenderTexture* frame_cache;
+
+            bool batching_enabled;
+            uint64_t n_batches;
+            GLNativeHandle batch_vertex_array_id;
+            GLNativeHandle batch_vertex_buffer_id;
+            GLNativeHandle batch_element_buffer_id;
+            std::vector<detail::VertexInfo>* batch_vertices;
+            std::vector<GLuint>* batch_indices;
+
+            bool statistics_enabled;
+            bool gpu_timing_enabled;
+            uint64_t frame_index;
+            FrameStatistics* statistics;
+            PendingFrameStatistics* current_statistics;
+            std::deque<PendingFrameStatistics>* pending_statistics;
+            std::vector<GLNativeHandle>* timestamp_query_pool;
         };
         using RenderAreaInternal = _RenderAreaInternal;
         DEFINE_INTERNAL_MAPPING(RenderArea);
+
+        /// @brief queue all tasks of the area rendering the shape to be re-indexed and re-sorted, called by the shape whenever its vertex positions change
+        void render_area_internal_shape_moved(RenderAreaInternal*, ShapeInternal*);
+
+        /// @brief queue all tasks of the area rendering the shape to be re-sorted, called by the shape whenever its texture changes
+        void render_area_internal_shape_texture_changed(RenderAreaInternal*, ShapeInternal*);
     }
     #endif
 
@@ -109,14 +288,88 @@ namespace mousetrap
 
             /// @brief add render task
             /// @param task allocated render task, this object will take ownership of the task
-            void add_render_task(RenderTask task);
+            /// @param layer tasks in lower layers are drawn before tasks in higher layers, tasks in the same layer are drawn in the order they were added, unless sorting is enabled
+            void add_render_task(RenderTask task, int32_t layer = 0);
+
+            /// @brief unregister a render task, if it was added more than once, all occurrences are removed
+            /// @param task
+            void remove_render_task(const RenderTask& task);
 
             /// @brief unregister all render tasks
             void clear_render_tasks();
 
-            /// @brief trigger the `render` function of all registered render tasks
+            /// @brief set whether tasks within the same layer should be reordered by shader, texture and blend mode to minimize state changes. Tasks are only reordered relative to each other if their screen area does not overlap or they blend commutatively, so the rendered image is unaffected. Off by default
+            /// @param b true if sorting should be enabled, false otherwise
+            void set_render_task_sorting_enabled(bool b);
+
+            /// @brief get whether tasks within the same layer are reordered to minimize state changes
+            /// @return true if sorting is enabled, false otherwise
+            bool get_render_task_sorting_enabled() const;
+
+            /// @brief get all render tasks whose shapes bounding box contains a point, tasks using a custom vertex shader or an instance buffer are never returned
+            /// @param gl_position position in gl coordinates, use mousetrap::RenderArea::to_gl_coordinates to convert from widget-space
+            /// @return tasks, in the order they are drawn in
+            std::vector<RenderTask> query_point(Vector2f gl_position);
+
+            /// @brief get all render tasks whose shapes bounding box overlaps a rectangle, tasks using a custom vertex shader or an instance buffer are never returned
+            /// @param gl_rectangle rectangle in gl coordinates, where top_left.y is the highest y-coordinate, use mousetrap::RenderArea::to_gl_coordinates to convert from widget-space
+            /// @return tasks, in the order they are drawn in
+            std::vector<RenderTask> query_rectangle(Rectangle gl_rectangle);
+
+            /// @brief set whether tasks whose shape lies entirely outside the visible area should be skipped. Tasks using a custom vertex shader or an instance buffer are always rendered. On by default
+            /// @param b true if culling should be enabled, false otherwise
+            void set_culling_enabled(bool b);
+
+            /// @brief get whether tasks outside the visible area are skipped
+            /// @return true if culling is enabled, false otherwise
+            bool get_culling_enabled() const;
+
+            /// @brief trigger the `render` function of all registered render tasks. If batching is enabled, consecutive tasks with identical state are merged into a single draw call
             void render_render_tasks();
 
+            /// @brief set whether consecutive render tasks that share shader, texture, transform, blend mode and uniforms should be merged into a single draw call, on by default
+            /// @param b true if batching should be enabled, false otherwise
+            void set_batching_enabled(bool b);
+
+            /// @brief get whether consecutive render tasks are merged into a single draw call
+            /// @return true if batching is enabled, false otherwise
+            bool get_batching_enabled() const;
+
+            /// @brief get the number of draw batches issued during the last frame, each batch corresponds to one draw call
+            /// @return number of batches
+            uint64_t get_n_batches() const;
+
+            /// @brief set whether draw calls, vertices, uploads and CPU time of each frame should be recorded, off by default
+            /// @param b true if statistics should be collected, false otherwise
+            void set_frame_statistics_enabled(bool b);
+
+            /// @brief get whether statistics of each frame are recorded
+            /// @return true if statistics are collected, false otherwise
+            bool get_frame_statistics_enabled() const;
+
+            /// @brief set whether frame statistics should include GPU time, measured using timer queries. Results only become available a few frames later, such that reading them never stalls the GPU. On by default, has no effect unless frame statistics are enabled
+            /// @param b true if GPU time should be measured, false otherwise
+            void set_gpu_timing_enabled(bool b);
+
+            /// @brief get whether frame statistics include GPU time
+            /// @return true if GPU time is measured, false otherwise
+            bool get_gpu_timing_enabled() const;
+
+            /// @brief get statistics of the most recent frame whose results are complete. If GPU timing is enabled, this frame lags a few frames behind the current one
+            /// @return statistics
+            FrameStatistics get_frame_statistics() const;
+
+            /// @brief set whether the last rendered frame should be cached and presented again, instead of re-executing all render tasks, as long as none of the tasks, their shapes, instance buffers, uniforms or textures were modified. Off by default
+            /// @param b true if frames should only be re-rendered when their content changed, false otherwise
+            void set_render_on_demand_enabled(bool b);
+
+            /// @brief get whether frames are only re-rendered when their content changed
+            /// @return true if render on demand is enabled, false otherwise
+            bool get_render_on_demand_enabled() const;
+
+            /// @brief force all render tasks to be re-executed during the next render, even if render on demand is enabled. Only necessary if state that is not tracked was modified, for example if a shader was recompiled or a user-defined mousetrap::TextureObject changed its content
+            void invalidate_frame_cache();
+
             /// @brief notify the area that a re-render should be done as soon as possible
             void queue_render();
 
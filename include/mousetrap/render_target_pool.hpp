@@ -0,0 +1,75 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#pragma once
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/time.hpp>
+#include <mousetrap/geometry.hpp>
+
+namespace mousetrap
+{
+    #ifndef DOXYGEN
+    namespace detail
+    {
+        struct RenderTargetAllocation
+        {
+            GLNativeHandle texture;
+            uint64_t n_samples;
+            Vector2i size;
+
+            bool in_use;
+            int64_t last_used;
+            int64_t oversized_since;
+        };
+
+        /// @brief round size up to the size render targets are allocated with, small sizes are rounded to powers of two, larger sizes to a multiple of the bucket size
+        Vector2i render_target_pool_get_bucket(Vector2i size);
+
+        /// @brief get color attachment for the given size, reusing an unused attachment if one fits
+        /// @param n_samples number of MSAA samples, if 0, the attachment is a regular GL_TEXTURE_2D
+        /// @param bucketed if true, the attachment may be larger than the size and is allocated rounded up to a bucket. Otherwise it is exactly the given size, which render targets exposed to the user need, as they are sampled with texture coordinates in [0, 1]
+        RenderTargetAllocation* render_target_pool_acquire(Vector2i size, uint64_t n_samples, bool bucketed);
+
+        /// @brief return attachment to the pool, it is freed once it was unused for longer than the shrink timeout
+        void render_target_pool_release(RenderTargetAllocation*);
+
+        /// @brief get attachment for a new size. The current attachment is kept if the size still fits, unless it was larger than needed for longer than the shrink timeout. Only call this where the content of the attachment is discarded anyway, a new attachment is not cleared
+        /// @param allocation current attachment, may be nullptr
+        /// @return new or unchanged attachment, the old attachment was released if they differ
+        RenderTargetAllocation* render_target_pool_resize(RenderTargetAllocation* allocation, Vector2i size, uint64_t n_samples, bool bucketed);
+
+        /// @brief get region of the attachment that is covered by a render target of the given size, in relative texture coordinates
+        Rectangle render_target_pool_get_texture_rectangle(RenderTargetAllocation*, Vector2i size);
+    }
+    #endif
+
+    /// @brief shared pool of the color attachments used by mousetrap::RenderTexture and mousetrap::MultisampledRenderTexture. Render targets owned by mousetrap::RenderArea round their size up to buckets, such that resizing the area only allocates GPU memory if the new size does not fit into its current attachment, render targets created by the user always have storage of exactly their size. Attachments that are unused, or larger than needed when their render target is resized, are freed once this was the case for longer than the shrink timeout
+    class RenderTargetPool
+    {
+        public:
+            /// @brief set how long unused or oversized attachments are kept before being freed, 5 seconds by default
+            /// @param duration
+            static void set_shrink_timeout(Time duration);
+
+            /// @brief get how long unused or oversized attachments are kept before being freed
+            /// @return duration
+            static Time get_shrink_timeout();
+
+            /// @brief immediately free all attachments that are not used by any render target
+            static void clear();
+
+            /// @brief get number of attachments, both used and unused
+            /// @return n
+            static uint64_t get_n_allocations();
+
+            /// @brief get GPU memory held by all attachments, both used and unused
+            /// @return number of bytes
+            static uint64_t get_n_bytes_allocated();
+    };
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
@@ -9,36 +9,92 @@
 #if MOUSETRAP_ENABLE_OPENGL_COMPONENT
 #include <mousetrap/shape.hpp>
 #include <mousetrap/shader.hpp>
+#include <mousetrap/shader_variant.hpp>
 #include <mousetrap/gl_transform.hpp>
 #include <mousetrap/blend_mode.hpp>
 
-#include <map>
+#include <vector>
 
 namespace mousetrap
 {
     #ifndef DOXYGEN
     namespace detail
     {
+        enum class UniformType
+        {
+            FLOAT,
+            INT,
+            UINT,
+            VEC2,
+            VEC3,
+            VEC4,
+            TRANSFORM
+        };
+
+        struct UniformBinding
+        {
+            std::string name;
+            UniformType type;
+            GLint location = -1;
+
+            union
+            {
+                float floats[16];
+                GLint int_value;
+                GLuint uint_value;
+            } value;
+        };
+
         struct _RenderTaskInternal
         {
             GObject parent;
 
             detail::ShapeInternal* _shape = nullptr;
             detail::ShaderInternal* _shader = nullptr;
+            detail::ShaderInternal* _fallback_shader = nullptr;
             GLTransform _transform;
             BlendMode _blend_mode;
 
             static inline Shader* noop_shader = nullptr;
 
-            std::map<std::string, float>* _floats;
-            std::map<std::string, int>* _ints;
-            std::map<std::string, glm::uint>* _uints;
-            std::map<std::string, Vector2f>* _vec2s;
-            std::map<std::string, Vector3f>* _vec3s;
-            std::map<std::string, Vector4f>* _vec4s;
-            std::map<std::string, GLTransform>* _transforms;
+            // tasks without a shader are rendered with a permutation of this, which does not branch on _texture_set
+            static inline ShaderVariant* noop_shader_variant = nullptr;
+            static inline uint64_t noop_textured_flag = 0;
+
+            // both permutations of noop_shader_variant, resolved once and kept alive by the task, such that ShaderVariant::clear_cache cannot free them
+            detail::ShaderInternal* _noop_untextured = nullptr;
+            detail::ShaderInternal* _noop_textured = nullptr;
+
+            std::vector<UniformBinding>* _uniforms;
+            GLNativeHandle _uniforms_program_id = 0;
+            uint64_t _uniforms_shader_version = 0;
+
+            uint64_t _version = 0;
+
+            uint64_t _bounds_version = 0;
+            bool _is_bounded = false;
+            Vector2f _bounds_min;
+            Vector2f _bounds_max;
         };
         using RenderTaskInternal = _RenderTaskInternal;
+
+        /// @brief get shader the task is rendered with, this is the fallback or default shader while the tasks own shader is still compiling. The default shader is specialized by whether the shape is textured
+        ShaderInternal* render_task_internal_get_shader(RenderTaskInternal*);
+
+        /// @brief advance asynchronous compilation of the tasks shader and its fallback by one step
+        void render_task_internal_advance_shaders(RenderTaskInternal*);
+
+        /// @brief bind the tasks shader, upload all registered uniforms and set the blend mode, without drawing the shape
+        void render_task_internal_apply_state(RenderTaskInternal*);
+
+        /// @brief get the area the task covers after the transform is applied, in gl coordinates, returns false if it cannot be known on the CPU, for example because a custom vertex shader is used
+        bool render_task_internal_get_bounds(RenderTaskInternal*, Vector2f& min, Vector2f& max);
+
+        /// @brief get latest version of the task, its shaders, shape, instance buffer and texture. If none of them were modified, the version does not change
+        uint64_t render_task_internal_get_version(RenderTaskInternal*);
+
+        /// @brief check whether two tasks use identical shader, texture, transform, blend mode and uniforms
+        bool render_task_internal_has_same_state(RenderTaskInternal*, RenderTaskInternal*);
     }
     #endif
 
@@ -59,6 +115,15 @@ namespace mousetrap
             /// @brief destructor
             ~RenderTask();
 
+            /// @brief copy ctor, both objects refer to the same task
+            /// @param other
+            RenderTask(const RenderTask& other);
+
+            /// @brief copy assignment, both objects refer to the same task
+            /// @param other
+            /// @return reference to self after assignment
+            RenderTask& operator=(const RenderTask& other);
+
             /// @brief register a float that will be handed to a shader uniform of the given name during render
             /// @param uniform_name name of the uniform variable in the glsl shader code, has to be of type <tt>float</tt>
             /// @param pointer pointer to value, the user is responsible for keeping it in scope
@@ -150,6 +215,15 @@ namespace mousetrap
             /// @return HSVA
             HSVA get_uniform_hsva(const std::string& uniform_name) const;
 
+            /// @brief replace the tasks shader with a permutation of a shader variant, the permutation is compiled if it was not used before
+            /// @param variant
+            /// @param flags combination of flags returned by mousetrap::ShaderVariant::add_define
+            void set_shader_variant(const ShaderVariant& variant, uint64_t flags);
+
+            /// @brief set shader that is used instead of the tasks shader while it is being compiled asynchronously, see mousetrap::Shader::create_from_string_async
+            /// @param shader fallback shader, if nullptr, the default shader is used
+            void set_fallback_shader(const Shader* shader);
+
             /// @brief perform the render step to the currently bound framebuffer
             void render() const;
 
@@ -20,13 +20,19 @@ namespace mousetrap
             GObject parent;
             GLNativeHandle framebuffer_handle;
             GLint before_buffer;
+
+            // storage rounded up to a bucket of mousetrap::RenderTargetPool, only used for render targets owned by mousetrap::RenderArea
+            bool bucketed;
         };
         using RenderTextureInternal = _RenderTextureInternal;
         DEFINE_INTERNAL_MAPPING(RenderTexture);
+
+        /// @brief attachment point of the texture in the render textures framebuffer
+        constexpr GLenum RENDER_TEXTURE_ATTACHMENT = GL_COLOR_ATTACHMENT5;
     }
     #endif
 
-    /// @brief texture that can be bound, such that any rendering happening afterwards will be pushed into the textures framebuffer. It can still be used like a regular texture
+    /// @brief texture that can be bound, such that any rendering happening afterwards will be pushed into the textures framebuffer. It can still be used like a regular texture, its storage is taken from mousetrap::RenderTargetPool
     class RenderTexture : public Texture
     {
         public:
@@ -60,6 +66,43 @@ namespace mousetrap
             /// @returns reference to self after assignment
             RenderTexture& operator=(RenderTexture&&);
 
+            /// @brief create as texture of given size with all pixels set to RGBA(0, 0, 0, 0). Storage is taken from mousetrap::RenderTargetPool, so an unused texture of the same size is reused instead of allocating GPU memory
+            /// @param width
+            /// @param height
+            void create(uint64_t width, uint64_t height);
+
+            /// @brief create as texture of the size of the image, then upload the image into it. Storage is taken from mousetrap::RenderTargetPool, like for mousetrap::RenderTexture::create
+            /// @param image
+            void create_from_image(const Image& image);
+
+            /// @brief create from an image on disk, see mousetrap::RenderTexture::create_from_image
+            /// @param path absolute path
+            /// @return true if operation was succesful, false otherwise
+            bool create_from_file(const std::string& path);
+
+            /// @brief render textures are always stored as TextureFormat::RGBA8, because their storage is shared through mousetrap::RenderTargetPool. Any other format is rejected
+            /// @param format
+            void set_format(TextureFormat format);
+
+            /// @brief get region of the underlying texture that holds the image, in relative texture coordinates
+            /// @return rectangle, {0, 0} is the top left of the texture. Always {{0, 0}, {1, 1}}, unless the texture is a render target owned by mousetrap::RenderArea
+            Rectangle get_texture_rectangle() const;
+
+            /// @brief download the region of the texture that holds the image into a CPU-side image, this is an extremely costly operation
+            /// @return image
+            [[nodiscard]] Image download() const;
+
+            /// @brief concurrently download the image into a CPU-side image. The transfer is queued behind all pending rendering commands, once it is done, <tt>on_done</tt> will be called from the main loop
+            /// @param on_done lambda with signature <tt>(const Image&, Data_t) -> void</tt>
+            /// @param data arbitrary data
+            template<typename Function_t, typename Data_t>
+            void download_async(Function_t on_done, Data_t data) const;
+
+            /// @brief concurrently download the image into a CPU-side image. The transfer is queued behind all pending rendering commands, once it is done, <tt>on_done</tt> will be called from the main loop
+            /// @param on_done lambda with signature <tt>(const Image&) -> void</tt>
+            template<typename Function_t>
+            void download_async(Function_t on_done) const;
+
             /// @brief bind texture as render target, from this point on all render calls will write to its internal framebuffer instead
             void bind_as_render_target() const;
 
@@ -74,5 +117,7 @@ namespace mousetrap
     };
 }
 
+#include "inline/render_texture.hpp"
+
 #endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
 
@@ -9,8 +9,10 @@
 #if MOUSETRAP_ENABLE_OPENGL_COMPONENT
 
 #include <string>
+#include <unordered_map>
 #include <mousetrap/gl_transform.hpp>
 #include <mousetrap/signal_emitter.hpp>
+#include <mousetrap/shader_cache.hpp>
 
 namespace mousetrap
 {
@@ -28,6 +30,24 @@ namespace mousetrap
     class Shader;
     namespace detail
     {
+        struct UniformLocationCache
+        {
+            GLNativeHandle program_id = 0;
+            std::unordered_map<std::string, GLint> locations;
+
+            GLint transform_location = -1;
+            GLint texture_set_location = -1;
+        };
+
+        enum class ShaderCompileStage
+        {
+            READY,
+            COMPILE_FRAGMENT,
+            COMPILE_VERTEX,
+            LINK,
+            WAIT_FOR_DRIVER
+        };
+
         struct _ShaderInternal
         {
             GObject parent;
@@ -35,13 +55,42 @@ namespace mousetrap
             GLNativeHandle program_id;
             GLNativeHandle fragment_shader_id;
             GLNativeHandle vertex_shader_id;
+            GLNativeHandle instanced_program_id;
 
-            static inline uint64_t noop_program_id;
-            static inline uint64_t noop_fragment_shader_id;
-            static inline uint64_t noop_vertex_shader_id;
+            // nullptr if the default shader is used. Shaders are compiled lazily, if the program was loaded from mousetrap::ShaderCache, they are never compiled
+            std::string* fragment_source;
+            std::string* vertex_source;
+
+            // asynchronous compilation, the program is linked by the driver in WAIT_FOR_DRIVER, otherwise one stage is done per frame
+            ShaderCompileStage compile_stage;
+            GLNativeHandle pending_program_id;
+            uint64_t version;
+
+            UniformLocationCache* uniform_cache;
+            UniformLocationCache* instanced_uniform_cache;
+
+            static inline GLNativeHandle noop_program_id;
+            static inline GLNativeHandle noop_fragment_shader_id;
+            static inline GLNativeHandle noop_vertex_shader_id;
+            static inline GLNativeHandle noop_instanced_vertex_shader_id;
         };
         using ShaderInternal = _ShaderInternal;
         DEFINE_INTERNAL_MAPPING(Shader);
+
+        /// @brief get uniform locations of either the shaders program or its instanced program, queried once after linking
+        UniformLocationCache* shader_internal_get_uniform_cache(ShaderInternal*, GLNativeHandle program_id);
+
+        /// @brief get location of a uniform in either the shaders program or its instanced program, without a GL round-trip if the location is cached
+        GLint shader_internal_get_uniform_location(ShaderInternal*, GLNativeHandle program_id, const std::string& name);
+
+        /// @brief incremented whenever the program of any shader is replaced, or a task switches shaders. Render areas only re-check the sort keys of all their tasks when this changes
+        inline uint64_t SHADER_PROGRAM_VERSION = 0;
+
+        /// @brief advance asynchronous compilation by one stage, or check whether the driver finished linking. Does nothing if the shader is not being compiled
+        void shader_internal_advance(ShaderInternal*);
+
+        /// @brief whether the program is linked and can be used
+        bool shader_internal_is_ready(ShaderInternal*);
     }
     #endif
 
@@ -68,20 +117,39 @@ namespace mousetrap
             /// @return id
             GLNativeHandle get_program_id() const;
 
-            /// @brief get the native OpenGL id of the fragment shader
+            /// @brief get the native OpenGL id of the program used when rendering a shape that has an mousetrap::InstanceBuffer attached. If the shader uses the default vertex shader, this is the fragment shader linked with the default instanced vertex shader, otherwise it is the same as mousetrap::Shader::get_program_id
+            /// @return id
+            GLNativeHandle get_instanced_program_id() const;
+
+            /// @brief get the native OpenGL id of the fragment shader, if the program was loaded from mousetrap::ShaderCache, this compiles the shader
             /// @return id
             GLNativeHandle get_fragment_shader_id() const;
 
-            /// @brief get the native OpenGL id of the vertex shader
+            /// @brief get the native OpenGL id of the vertex shader, if the program was loaded from mousetrap::ShaderCache, this compiles the shader
             /// @return id
             GLNativeHandle get_vertex_shader_id() const;
 
-            /// @brief create shader from source code as string
+            /// @brief create shader from source code as string. If a binary of the resulting program is in mousetrap::ShaderCache, it is loaded instead of compiling the source
             /// @param type One of ShaderType::FRAGMENT or ShaderType::VERTEX
             /// @param code glsl code
             /// @return true if compiled succesfully, false otherwise
             bool create_from_string(ShaderType type, const std::string& code);
 
+            /// @brief create shader from source code as string without blocking. If the driver supports <tt>GL_KHR_parallel_shader_compile</tt>, it compiles the program on its own threads, otherwise compiling and linking is spread across the following frames. Until mousetrap::Shader::is_ready returns true, mousetrap::RenderTask renders with its fallback shader instead
+            /// @param type One of ShaderType::FRAGMENT or ShaderType::VERTEX
+            /// @param code glsl code
+            void create_from_string_async(ShaderType type, const std::string& code);
+
+            /// @brief create shader from a file without blocking, see mousetrap::Shader::create_from_string_async
+            /// @param type One of ShaderType::FRAGMENT or ShaderType::VERTEX
+            /// @param path absolute path to file with glsl code
+            /// @return true if the file was accessed, false otherwise
+            bool create_from_file_async(ShaderType type, const std::string& path);
+
+            /// @brief get whether the program is linked and can be used. Asynchronous compilation only progresses while the shader is rendered through a mousetrap::RenderTask
+            /// @return false while compiling asynchronously or if compilation failed, true otherwise
+            bool is_ready() const;
+
             /// @brief create shader from a file, usually .glsl, .frag or .vert
             /// @param type One of ShaderType::FRAGMENT or ShaderType::VERTEX
             /// @param path absolute path to file with glsl code
@@ -140,6 +208,18 @@ namespace mousetrap
             /// @returns position
             static int get_vertex_texture_coordinate_location();
 
+            /// @brief get position of the per-instance <tt>mat4 _instance_transform</tt> vertex attribute, it occupies this and the following 3 locations
+            /// @returns position
+            static int get_instance_transform_location();
+
+            /// @brief get position of the per-instance <tt>vec4 _instance_color</tt> vertex attribute
+            /// @returns position
+            static int get_instance_color_location();
+
+            /// @brief get position of the per-instance <tt>vec4 _instance_texture_rectangle</tt> vertex attribute, holds x, y, width, height of the texture region in relative texture coordinates
+            /// @returns position
+            static int get_instance_texture_rectangle_location();
+
             /// @brief default fragment shader behavior, render a shape respecting its vertices colors and its optional texture
             static inline const std::string noop_fragment_shader_code = R"(
                 #version 130
@@ -185,9 +265,37 @@ namespace mousetrap
                 }
             )";
 
+            /// @brief default vertex shader used when rendering a shape with an mousetrap::InstanceBuffer attached, applies the per-instance transform, color and texture region
+            static inline const std::string noop_instanced_vertex_shader_code = R"(
+                #version 330
+
+                layout (location = 0) in vec3 _vertex_position_in;
+                layout (location = 1) in vec4 _vertex_color_in;
+                layout (location = 2) in vec2 _vertex_texture_coordinates_in;
+
+                layout (location = 3) in mat4 _instance_transform;
+                layout (location = 7) in vec4 _instance_color;
+                layout (location = 8) in vec4 _instance_texture_rectangle;
+
+                uniform mat4 _transform;
+
+                out vec4 _vertex_color;
+                out vec2 _texture_coordinates;
+                out vec3 _vertex_position;
+
+                void main()
+                {
+                    gl_Position = _transform * _instance_transform * vec4(_vertex_position_in, 1.0);
+                    _vertex_color = _vertex_color_in * _instance_color;
+                    _vertex_position = _vertex_position_in;
+                    _texture_coordinates = _instance_texture_rectangle.xy + _vertex_texture_coordinates_in * _instance_texture_rectangle.zw;
+                }
+            )";
+
         private:
-            [[nodiscard]] GLNativeHandle compile_shader(const std::string&, ShaderType shader_type);
-            [[nodiscard]] GLNativeHandle link_program(GLNativeHandle fragment_id, GLNativeHandle vertex_id);
+            [[nodiscard]] GLNativeHandle compile_shader(const std::string&, ShaderType shader_type) const;
+            [[nodiscard]] GLNativeHandle link_program(GLNativeHandle fragment_id, GLNativeHandle vertex_id) const;
+            [[nodiscard]] GLNativeHandle create_program(const std::string& fragment_source, const std::string& vertex_source, GLNativeHandle& fragment_id, GLNativeHandle& vertex_id) const;
 
             detail::ShaderInternal* _internal = nullptr;
     };
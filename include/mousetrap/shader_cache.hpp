@@ -0,0 +1,57 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#pragma once
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <string>
+
+namespace mousetrap
+{
+    #ifndef DOXYGEN
+    namespace detail
+    {
+        /// @brief whether the driver can export and import program binaries
+        bool shader_cache_is_available();
+
+        /// @brief create program from a cached binary of the program linked from the given sources
+        /// @return program id, or 0 if no binary is cached or the driver rejected it
+        GLNativeHandle shader_cache_load(const std::string& fragment_source, const std::string& vertex_source);
+
+        /// @brief mark program as retrievable, has to be called before linking
+        void shader_cache_prepare(GLNativeHandle program_id);
+
+        /// @brief write binary of a successfully linked program to disk
+        void shader_cache_store(GLNativeHandle program_id, const std::string& fragment_source, const std::string& vertex_source);
+    }
+    #endif
+
+    /// @brief on-disk cache of linked mousetrap::Shader programs. Binaries are keyed by the shader sources, the attribute locations and the driver, such that updating the driver or editing a shader never loads a stale binary. If the driver rejects a binary, the program is compiled from source instead
+    class ShaderCache
+    {
+        public:
+            /// @brief set whether programs are loaded from and written to the cache, true by default
+            /// @param b
+            static void set_enabled(bool);
+
+            /// @brief get whether programs are loaded from and written to the cache
+            /// @return true if enabled and supported by the driver, false otherwise
+            static bool get_enabled();
+
+            /// @brief set directory binaries are stored in, <tt>$XDG_CACHE_HOME/mousetrap/shader_cache</tt> by default. The directory is created once the first binary is written
+            /// @param path absolute path
+            static void set_directory(const std::string& path);
+
+            /// @brief get directory binaries are stored in
+            /// @return absolute path
+            static std::string get_directory();
+
+            /// @brief delete all binaries in the cache directory
+            static void clear();
+    };
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
@@ -0,0 +1,94 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#pragma once
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/shader.hpp>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace mousetrap
+{
+    #ifndef DOXYGEN
+    namespace detail
+    {
+        /// @brief insert one <tt>#define</tt> per name after the <tt>#version</tt> line, followed by a <tt>#line</tt> directive such that compiler errors refer to lines of the original source
+        std::string shader_variant_inject_defines(const std::string& source, const std::vector<std::string>& defines);
+    }
+    #endif
+
+    /// @brief set of shader permutations that share the same source and differ only by preprocessor defines. Each permutation is compiled the first time it is requested, permutations with identical source and defines are shared between all variants, such that a feature toggle can be resolved at compile time instead of branching on a uniform for every fragment
+    class ShaderVariant
+    {
+        public:
+            /// @brief construct, uses the default vertex shader and a default fragment shader that samples the shapes texture only if <tt>MOUSETRAP_TEXTURED</tt> is defined
+            ShaderVariant();
+
+            /// @brief set source of either shader, may contain <tt>#ifdef</tt> blocks for any of the registered defines. Does not compile anything
+            /// @param type One of ShaderType::FRAGMENT or ShaderType::VERTEX
+            /// @param code glsl code, has to start with a <tt>#version</tt> directive
+            void create_from_string(ShaderType type, const std::string& code);
+
+            /// @brief set source of either shader from a file, see mousetrap::ShaderVariant::create_from_string
+            /// @param type One of ShaderType::FRAGMENT or ShaderType::VERTEX
+            /// @param path absolute path to file with glsl code
+            /// @return true if the file was accessed, false otherwise
+            bool create_from_file(ShaderType type, const std::string& path);
+
+            /// @brief register a define that can be toggled per permutation
+            /// @param name name of the define, it is defined as <tt>1</tt> if its flag is set
+            /// @return flag of the define, permutations are selected by combining flags with <tt>|</tt>. At most 64 defines can be registered
+            uint64_t add_define(const std::string& name);
+
+            /// @brief get all registered defines
+            /// @return names, in order of registration, the i-th define has flag <tt>1 << i</tt>
+            const std::vector<std::string>& get_defines() const;
+
+            /// @brief get permutation with the given defines set, compiles it if it was not requested before by any variant
+            /// @param flags combination of flags returned by mousetrap::ShaderVariant::add_define
+            /// @return shader, stays valid until mousetrap::ShaderVariant::clear_cache is called
+            const Shader& get_shader(uint64_t flags) const;
+
+            /// @brief free all compiled permutations of all variants, render tasks that use a permutation keep it alive
+            static void clear_cache();
+
+            /// @brief default fragment shader of a shader variant, specialized by <tt>MOUSETRAP_TEXTURED</tt> instead of the <tt>_texture_set</tt> uniform
+            static inline const std::string default_fragment_shader_code = R"(
+                #version 130
+
+                in vec4 _vertex_color;
+                in vec2 _texture_coordinates;
+                in vec3 _vertex_position;
+
+                out vec4 _fragment_color;
+
+                uniform sampler2D _texture;
+
+                void main()
+                {
+                #ifdef MOUSETRAP_TEXTURED
+                    _fragment_color = texture2D(_texture, _texture_coordinates) * _vertex_color;
+                #else
+                    _fragment_color = _vertex_color;
+                #endif
+                }
+            )";
+
+        private:
+            std::string _fragment_source;
+            std::string _vertex_source;
+            std::vector<std::string> _defines;
+
+            // permutations this variant already resolved, by flags, such that repeated requests do not rebuild the cache key
+            mutable std::unordered_map<uint64_t, Shader*> _permutations;
+            mutable uint64_t _permutations_generation;
+    };
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
@@ -12,11 +12,13 @@
 #include <string>
 #include <algorithm>
 #include <mutex>
+#include <unordered_map>
 
 #include <mousetrap/shader.hpp>
 #include <mousetrap/color.hpp>
 #include <mousetrap/gl_transform.hpp>
 #include <mousetrap/texture.hpp>
+#include <mousetrap/instance_buffer.hpp>
 #include <mousetrap/geometry.hpp>
 #include <mousetrap/signal_emitter.hpp>
 
@@ -43,6 +45,16 @@ namespace mousetrap
         Vector2f texture_coordinates;
     };
 
+    /// @brief layout of a shapes vertices, both cpu- and gpu-side
+    enum class VertexFormat
+    {
+        /// @brief 3d position, 32-bit float color and texture coordinates, 36 bytes per vertex
+        FULL,
+
+        /// @brief 2d position, 8-bit normalized color, 16-bit float texture coordinates, 16 bytes per vertex. Colors are clamped to [0, 1], the z-coordinate of positions is discarded
+        COMPACT
+    };
+
     #ifndef DOXYGEN
     class Shape;
     namespace detail
@@ -54,6 +66,13 @@ namespace mousetrap
             float _texture_coordinates[2];
         };
 
+        struct CompactVertexInfo
+        {
+            float _position[2];
+            uint8_t _color[4];
+            uint16_t _texture_coordinates[2]; // half floats
+        };
+
         enum class ShapeType
         {
             UNKNOWN,
@@ -74,6 +93,8 @@ namespace mousetrap
             OUTLINE
         };
 
+        struct _RenderAreaInternal;
+
         struct _ShapeInternal
         {
             GObject parent;
@@ -81,20 +102,59 @@ namespace mousetrap
             RGBA* color;
             bool is_visible = true;
 
-            std::vector<Vertex>* vertices;
             std::vector<int>* indices;
             GLenum render_type = GL_TRIANGLE_STRIP;
             ShapeType shape_type = ShapeType::UNKNOWN;
 
+            // only copy of the vertices cpu-side, accessors read and write it directly. Depending on the format, only one of both is in use
+            VertexFormat vertex_format = VertexFormat::FULL;
             std::vector<VertexInfo>* vertex_data;
+            std::vector<CompactVertexInfo>* compact_vertex_data;
 
             GLNativeHandle vertex_array_id = 0;
             GLNativeHandle vertex_buffer_id = 0;
+            GLNativeHandle element_buffer_id = 0;
+
+            GLenum index_type = GL_UNSIGNED_INT;
+            uint64_t n_indices = 0;
+
+            uint64_t vertex_buffer_size = 0;
+
+            // sorted, non-overlapping [first, last) vertex ranges modified since the last upload
+            std::vector<std::pair<uint64_t, uint64_t>>* dirty_ranges;
+
+            uint64_t geometry_version = 0;
+            uint64_t version = 0;
+
+            uint64_t bounds_version = 0;
+            Vector3f bounds_min;
+            Vector3f bounds_max;
 
             const TextureObject* texture = nullptr;
+
+            const InstanceBuffer* instance_buffer = nullptr;
+            GLNativeHandle bound_instance_buffer_id = 0;
+
+            // render areas that index a task rendering this shape, with the number of such tasks, notified when the shape moves
+            std::unordered_map<_RenderAreaInternal*, uint64_t>* indexing_areas;
         };
         using ShapeInternal = _ShapeInternal;
         DEFINE_INTERNAL_MAPPING(Shape);
+
+        /// @brief mark the vertex positions of a shape as modified, notifies all render areas indexing the shape
+        void shape_internal_geometry_changed(ShapeInternal*);
+
+        /// @brief get latest version of the shape, its instance buffer and its texture, changes whenever any of them is modified
+        uint64_t shape_internal_get_version(ShapeInternal*);
+
+        /// @brief get axis aligned bounding box of all vertices, only recomputed if vertex positions changed since the last call
+        void shape_internal_get_bounds(ShapeInternal*, Vector3f& min, Vector3f& max);
+
+        /// @brief get number of vertices, regardless of format
+        uint64_t shape_internal_get_n_vertices(ShapeInternal*);
+
+        /// @brief append all vertices in the full format, converting them if the shape is compact
+        void shape_internal_append_vertex_data(ShapeInternal*, std::vector<VertexInfo>& out);
     }
     #endif
 
@@ -148,6 +208,11 @@ namespace mousetrap
             /// @param points vector of points
             void as_points(const std::vector<Vector2f>& points);
 
+            /// @brief construct as set of points, writes the positions directly into the vertex buffer without intermediate copies
+            /// @param points pointer to the first of n points, in gl coordinates, not retained after the call
+            /// @param n number of points
+            void as_points(const Vector2f* points, uint64_t n);
+
             /// @copydoc Shape::as_points
             static Shape Points(const std::vector<Vector2f>& points);
 
@@ -199,6 +264,11 @@ namespace mousetrap
             /// @param points vector of pairs of 2 points, both in gl coordinates
             void as_lines(const std::vector<std::pair<Vector2f, Vector2f>>& points);
 
+            /// @brief construct as set of lines, writes the positions directly into the vertex buffer without intermediate copies
+            /// @param lines pointer to the first of n pairs of 2 points, both in gl coordinates, not retained after the call
+            /// @param n number of lines
+            void as_lines(const std::pair<Vector2f, Vector2f>* lines, uint64_t n);
+
             /// @copydoc Shape::as_lines
             static Shape Lines(const std::vector<std::pair<Vector2f, Vector2f>>& points);
 
@@ -206,6 +276,11 @@ namespace mousetrap
             /// @param points {a1, a2, ..., an} will result in line segments {a1, a2}, {a2, a3}, ..., {an-1, an}
             void as_line_strip(const std::vector<Vector2f>& points);
 
+            /// @brief construct as set of connected lines, writes the positions directly into the vertex buffer without intermediate copies
+            /// @param points pointer to the first of n points, in gl coordinates, not retained after the call
+            /// @param n number of points
+            void as_line_strip(const Vector2f* points, uint64_t n);
+
             /// @copydoc Shape::as_line_strip
             static Shape LineStrip(const std::vector<Vector2f>& points);
 
@@ -213,6 +288,11 @@ namespace mousetrap
             /// @param points points in gl coordinates, minimum bounding polygon is calculated on these, so some of the vertices ay be discarded
             void as_polygon(const std::vector<Vector2f>& points);
 
+            /// @brief construct as convex polygon, writes the sorted positions directly into the vertex buffer
+            /// @param points pointer to the first of n points, in gl coordinates, not retained after the call
+            /// @param n number of points
+            void as_polygon(const Vector2f* points, uint64_t n);
+
             /// @copydoc Shape::as_polygon
             static Shape Polygon(const std::vector<Vector2f>& points);
 
@@ -290,7 +370,7 @@ namespace mousetrap
             /// @brief set vertex position in 3d space, does nothing if index out of bounds
             /// @param index vertex index
             /// @param position position in 3d space
-            /// @note if multiple vertex positions change at the same time, use mousetrap::Vertex::as_rectangle (or other appropriate shape) to update all of them at once in a more performant manned
+            /// @note changes are uploaded to the graphics card the next time the shape is rendered, only the range of vertices that was modified since the last render is transferred
             void set_vertex_position(uint64_t index, Vector3f position);
 
             /// @brief get vertex position in 3d space, return Vector3f() if out of bounds
@@ -302,6 +382,14 @@ namespace mousetrap
             /// @return number of vertices
             uint64_t get_n_vertices() const;
 
+            /// @brief set layout vertices are stored and uploaded in, converts all current vertices. Shapes are mousetrap::VertexFormat::FULL by default
+            /// @param format mousetrap::VertexFormat::COMPACT reduces memory and upload bandwidth for large 2d meshes, at reduced color and texture coordinate precision
+            void set_vertex_format(VertexFormat format);
+
+            /// @brief get layout vertices are stored and uploaded in
+            /// @return format
+            VertexFormat get_vertex_format() const;
+
             /// @brief set color of all vertices at once
             /// @param rgba color in RGBA
             void set_color(RGBA rgba);
@@ -351,6 +439,14 @@ namespace mousetrap
             /// @returns pointer to texture object, or nullptr if no texture is registered
             const TextureObject* get_texture() const;
 
+            /// @brief attach an instance buffer, if set and non-empty, the shape will be rendered once per instance in a single draw call
+            /// @param instance_buffer buffer holding per-instance transform, color and texture region. The user is responsible for making sure the buffer stays in memory. May be nullptr
+            void set_instance_buffer(const InstanceBuffer* instance_buffer);
+
+            /// @brief get the attached instance buffer
+            /// @return pointer to instance buffer, or nullptr if no instance buffer is attached
+            const InstanceBuffer* get_instance_buffer() const;
+
             /// @brief expose as GObject
             operator NativeObject() const override;
 
@@ -358,15 +454,14 @@ namespace mousetrap
             void update_position() const;
             void update_color() const;
             void update_texture_coordinate() const;
+            void update_vertex(uint64_t) const;
             void initialize();
 
-            std::vector<Vector2f> sort_by_angle(const std::vector<Vector2f>&);
+            std::vector<Vector2f> sort_by_angle(const Vector2f* points, uint64_t n);
 
-            void update_data(
-                bool update_position = true,
-                bool update_color = true,
-                bool update_tex_coords = true
-            ) const;
+            void queue_update(uint64_t first, uint64_t last) const;
+            void update_data() const;
+            void update_indices() const;
 
             detail::ShapeInternal* _internal = nullptr;
     };
@@ -0,0 +1,98 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#pragma once
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <vector>
+#include <mousetrap/texture.hpp>
+
+namespace mousetrap
+{
+    #ifndef DOXYGEN
+    class StreamingTexture;
+    namespace detail
+    {
+        struct _StreamingTextureInternal
+        {
+            GObject parent;
+
+            std::vector<GLNativeHandle>* pixel_buffers;
+            std::vector<GLsync>* fences;
+            uint64_t next_buffer;
+
+            uint64_t buffer_size;
+            bool is_immutable;
+        };
+        using StreamingTextureInternal = _StreamingTextureInternal;
+        DEFINE_INTERNAL_MAPPING(StreamingTexture);
+    }
+    #endif
+
+    /// @brief texture optimized for being updated every frame, for example with video or simulation output. Uploads are staged in a ring of pixel buffers, such that the CPU can fill the next frame while the previous one is still being transferred to the GPU
+    class StreamingTexture : public Texture
+    {
+        public:
+            /// @brief construct as texture of size 0x0
+            /// @param n_buffers number of frames that can be in flight at the same time, 2 for double-, 3 for triple-buffering
+            StreamingTexture(uint64_t n_buffers = 3);
+
+            /// @brief construct from internal
+            StreamingTexture(detail::StreamingTextureInternal*);
+
+            /// @brief destructor
+            ~StreamingTexture();
+
+            /// @brief expose internal
+            NativeObject get_internal() const override;
+
+            /// @brief copy ctor deleted
+            StreamingTexture(const StreamingTexture&) = delete;
+
+            /// @brief copy assignment deleted
+            StreamingTexture& operator=(const StreamingTexture&) = delete;
+
+            /// @brief allocate storage for frames of the given size, this is only done once, after which the size of the texture cannot change
+            /// @param width
+            /// @param height
+            void create(uint64_t width, uint64_t height);
+
+            /// @brief allocate storage of the size of the image, then queue the image as the first frame. Like mousetrap::StreamingTexture::create, this can only be done once
+            /// @param image
+            void create_from_image(const Image& image);
+
+            /// @brief allocate storage of the size of an image on disk, then queue the image as the first frame. Like mousetrap::StreamingTexture::create, this can only be done once
+            /// @param path absolute path
+            /// @return true if operation was succesful, false otherwise
+            bool create_from_file(const std::string& path);
+
+            /// @brief streaming textures are always stored as TextureFormat::RGBA8, any other format is rejected
+            /// @param format
+            void set_format(TextureFormat format);
+
+            /// @brief queue an image for upload, returns without waiting for the transfer to finish. The image has to have the size the texture was created with
+            /// @param image
+            void push_frame(const Image& image);
+
+            /// @brief queue raw pixel data for upload, returns without waiting for the transfer to finish
+            /// @param data tightly packed 8-bit RGBA pixels, at least width * height * 4 bytes, rows ordered top to bottom
+            void push_frame(const void* data);
+
+            /// @brief get number of frames that can be in flight at the same time
+            /// @return number of buffers
+            uint64_t get_n_buffers() const;
+
+            /// @brief expose as gobject, \for_internal_use_only
+            operator GObject*() const override;
+
+        private:
+            void push_frame(const void* data, uint64_t n_bytes, GLenum format);
+
+            detail::StreamingTextureInternal* _internal = nullptr;
+    };
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
@@ -8,11 +8,15 @@
 #include <mousetrap/gl_common.hpp>
 #if MOUSETRAP_ENABLE_OPENGL_COMPONENT
 
+#include <functional>
 #include <string>
+#include <vector>
 #include <mousetrap/image.hpp>
 #include <mousetrap/texture_object.hpp>
 #include <mousetrap/texture_wrap_mode.hpp>
 #include <mousetrap/texture_scale_mode.hpp>
+#include <mousetrap/texture_format.hpp>
+#include <mousetrap/render_target_pool.hpp>
 #include <mousetrap/signal_emitter.hpp>
 
 namespace mousetrap
@@ -20,6 +24,14 @@ namespace mousetrap
     #ifndef DOXYGEN
     namespace detail
     {
+        struct TextureRegionUpdate
+        {
+            GdkPixbuf* pixbuf;
+            Vector2i src_offset;
+            Vector2i dst_offset;
+            Vector2i size;
+        };
+
         struct _TextureInternal
         {
             GObject parent;
@@ -27,9 +39,42 @@ namespace mousetrap
             GLNativeHandle native_handle = 0;
             TextureWrapMode wrap_mode = TextureWrapMode::STRETCH;
             TextureScaleMode scale_mode = TextureScaleMode::NEAREST;
+            TextureFormat format = TextureFormat::RGBA8;
+            float anisotropy_level = 1;
+            GLNativeHandle sampler_id = 0;
+            bool mipmap_dirty = false;
+            uint64_t version = 0;
             Vector2i* size;
+
+            RenderTargetAllocation* render_target_allocation;
+
+            std::vector<TextureRegionUpdate>* pending_updates;
         };
         using TextureInternal = _TextureInternal;
+
+        /// @brief drop all regions queued by mousetrap::Texture::update_region without uploading them
+        void texture_internal_clear_updates(TextureInternal*);
+
+        /// @brief upload all regions queued by mousetrap::Texture::update_region, called automatically when the texture is bound
+        void texture_internal_flush_updates(TextureInternal*);
+
+        /// @brief read texture into a pixel buffer, then invoke on_done with the resulting image from the main loop once the transfer finished. Takes ownership of on_done
+        void texture_internal_download_async(GLNativeHandle texture, Vector2i size, std::function<void(const Image&)>* on_done);
+
+        /// @brief same as texture_internal_download_async, but reads the bottom-left region of the given size from a framebuffer attachment, for render targets whose texture is larger than their content
+        void texture_internal_download_framebuffer_async(GLNativeHandle framebuffer, GLenum attachment, Vector2i size, std::function<void(const Image&)>* on_done);
+
+        /// @brief read the bottom-left region of the given size from a framebuffer attachment into out, or into the bound pack buffer if out is nullptr
+        void texture_internal_read_framebuffer(GLNativeHandle framebuffer, GLenum attachment, Vector2i size, void* out);
+
+        /// @brief get the internal format actually used for allocation, unsupported compressed formats fall back to GL_RGBA8
+        GLenum texture_internal_resolve_format(TextureFormat);
+
+        /// @brief get sampler object for a wrap mode / scale mode / anisotropy combination, each combination is only created once and shared between all textures
+        GLNativeHandle texture_internal_get_sampler(TextureWrapMode, TextureScaleMode, float anisotropy_level);
+
+        /// @brief check whether scale mode samples from a mip chain
+        bool texture_scale_mode_uses_mipmap(TextureScaleMode);
     }
     #endif
 
@@ -70,6 +115,17 @@ namespace mousetrap
             /// @brief download texture data into a CPU-side image, this is an extremely costly operation
             [[nodiscard]] Image download() const;
 
+            /// @brief concurrently download texture data into a CPU-side image. The transfer is queued behind all pending rendering commands, once it is done, <tt>on_done</tt> will be called from the main loop. Neither the CPU nor the GPU waits for the other
+            /// @param on_done lambda with signature <tt>(const Image&, Data_t) -> void</tt>
+            /// @param data arbitrary data
+            template<typename Function_t, typename Data_t>
+            void download_async(Function_t on_done, Data_t data) const;
+
+            /// @brief concurrently download texture data into a CPU-side image. The transfer is queued behind all pending rendering commands, once it is done, <tt>on_done</tt> will be called from the main loop. Neither the CPU nor the GPU waits for the other
+            /// @param on_done lambda with signature <tt>(const Image&) -> void</tt>
+            template<typename Function_t>
+            void download_async(Function_t on_done) const;
+
             /// @brief bind the texture for rendering
             /// @param texture_unit texture unit to bind to, usually <tt>GL_TEXTURE0 + n</tt> where n = 0, 1, ...
             void bind(uint64_t texture_unit) const;
@@ -80,6 +136,10 @@ namespace mousetrap
             /// @brief unbind texture
             void unbind() const override;
 
+            /// @brief get version of the texture content, changes whenever the texture is re-allocated, updated, rendered to or its sampling state is modified
+            /// @return version
+            uint64_t get_version() const override;
+
             /// @brief create texture as an image of given size with all pixels set to RGBA(0, 0, 0, 0)
             /// @param width
             /// @param height
@@ -94,6 +154,13 @@ namespace mousetrap
             /// @param image
             void create_from_image(const Image&);
 
+            /// @brief update a rectangular region of the texture from a region of an image, without re-uploading the rest of the texture. Updates are queued and uploaded the next time the texture is bound, overlapping or adjacent regions queued from the same image are merged into a single upload
+            /// @param image image to read from, has to stay alive until the texture is bound next, any changes to its pixels until then are uploaded as well
+            /// @param src_offset top left pixel of the region in the image
+            /// @param dst_offset top left pixel of the region in the texture
+            /// @param size width and height of the region, in pixels
+            void update_region(const Image& image, Vector2i src_offset, Vector2i dst_offset, Vector2ui size);
+
             /// @brief set wrap mode, this governs how the texture behaves when the texture coordinates of a vertex are outside of [0, 1]
             /// @param wrap_mode
             void set_wrap_mode(TextureWrapMode);
@@ -110,6 +177,25 @@ namespace mousetrap
             /// @return scale mode
             TextureScaleMode get_scale_mode();
 
+            /// @brief regenerate the mip chain from the full-resolution image. For mipmapped scale modes, this happens automatically the next time the texture is bound after its content changed
+            void generate_mipmap();
+
+            /// @brief set maximum anisotropy level, this improves the sharpness of textures viewed at an angle or scaled non-uniformly. Clamped to the maximum supported by the hardware, 1 disables anisotropic filtering
+            /// @param level
+            void set_anisotropy_level(float level);
+
+            /// @brief get maximum anisotropy level
+            /// @return level
+            float get_anisotropy_level() const;
+
+            /// @brief set the GPU-side storage format, takes effect the next time the texture is created using mousetrap::Texture::create or mousetrap::Texture::create_from_image. TextureFormat::RGBA8 by default
+            /// @param format
+            void set_format(TextureFormat format);
+
+            /// @brief get the GPU-side storage format
+            /// @return format
+            TextureFormat get_format() const;
+
             /// @brief get native resolution of the texture
             /// @return width, height
             /// @note unlike in OpenGL, this operation is in O(1)
@@ -127,4 +213,6 @@ namespace mousetrap
     };
 }
 
+#include "inline/texture.hpp"
+
 #endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
\ No newline at end of file
@@ -0,0 +1,137 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#pragma once
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <map>
+#include <vector>
+
+#include <mousetrap/geometry.hpp>
+#include <mousetrap/image.hpp>
+#include <mousetrap/texture.hpp>
+#include <mousetrap/signal_emitter.hpp>
+
+namespace mousetrap
+{
+    #ifndef DOXYGEN
+    class TextureAtlas;
+    namespace detail
+    {
+        struct TextureAtlasSkylineNode
+        {
+            uint64_t x;
+            uint64_t y;
+            uint64_t width;
+        };
+
+        struct TextureAtlasPage
+        {
+            Texture* texture;
+            Image* image;
+            std::vector<TextureAtlasSkylineNode>* skyline;
+            uint64_t allocated_area;
+            uint64_t used_area;
+        };
+
+        struct TextureAtlasEntry
+        {
+            uint64_t page;
+            Vector2ui position;
+            Vector2ui size;
+        };
+
+        struct _TextureAtlasInternal
+        {
+            GObject parent;
+
+            std::vector<TextureAtlasPage>* pages;
+            std::map<uint64_t, TextureAtlasEntry>* entries;
+            uint64_t next_id;
+
+            Vector2ui page_size;
+            uint64_t padding;
+        };
+        using TextureAtlasInternal = _TextureAtlasInternal;
+        DEFINE_INTERNAL_MAPPING(TextureAtlas);
+    }
+    #endif
+
+    /// @brief packs many small images into a few large textures, such that shapes using different images can share a texture binding. Images are placed using a skyline packer, if no page has room, a new page is added. Images never move unless mousetrap::TextureAtlas::defragment is called
+    class TextureAtlas : public SignalEmitter
+    {
+        public:
+            /// @brief construct with 0 pages
+            /// @param page_width width of each page texture, in pixels
+            /// @param page_height height of each page texture, in pixels
+            /// @param padding number of transparent pixels between images, prevents neighbouring images from bleeding into each other when the texture is interpolated
+            TextureAtlas(uint64_t page_width = 2048, uint64_t page_height = 2048, uint64_t padding = 1);
+
+            /// @brief construct from internal, \for_internal_use_only
+            TextureAtlas(detail::TextureAtlasInternal*);
+
+            /// @brief destructor, frees all pages
+            ~TextureAtlas();
+
+            /// @brief copy ctor deleted
+            TextureAtlas(const TextureAtlas&) = delete;
+
+            /// @brief copy assignment deleted
+            TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+            /// @brief expose internal
+            NativeObject get_internal() const override;
+
+            /// @brief expose as GObject, \for_internal_use_only
+            operator NativeObject() const override;
+
+            /// @brief copy an image into the atlas. The image is uploaded the next time its page is bound
+            /// @param image
+            /// @return id of the image, used to query its location. 0 if the image is larger than a page
+            uint64_t add_image(const Image& image);
+
+            /// @brief remove an image from the atlas, its space is reclaimed the next time the atlas is defragmented
+            /// @param id
+            void remove_image(uint64_t id);
+
+            /// @brief check whether an image with the given id is part of the atlas
+            /// @param id
+            /// @return true if image is in the atlas, false otherwise
+            bool has_image(uint64_t id) const;
+
+            /// @brief get region of the page texture the image occupies, in relative texture coordinates, {0, 0} is the top left of the page. Can be used with mousetrap::Shape::set_vertex_texture_coordinate or mousetrap::Instance::texture_rectangle
+            /// @param id
+            /// @return rectangle
+            Rectangle get_texture_rectangle(uint64_t id) const;
+
+            /// @brief get index of the page the image is on
+            /// @param id
+            /// @return page index
+            uint64_t get_page_index(uint64_t id) const;
+
+            /// @brief get texture of a page, for use with mousetrap::Shape::set_texture
+            /// @param page_index
+            /// @return texture, stays valid until the atlas is destroyed or mousetrap::TextureAtlas::defragment frees the page. If the index is out of bounds, an empty texture is returned
+            Texture& get_page(uint64_t page_index) const;
+
+            /// @brief get number of pages
+            /// @return n
+            uint64_t get_n_pages() const;
+
+            /// @brief get number of images in the atlas
+            /// @return n
+            uint64_t get_n_images() const;
+
+            /// @brief repack all images, reclaiming space of removed images and freeing pages that are no longer needed. This never happens automatically
+            /// @note this may change the page and texture rectangle of any image, they should be queried again afterwards. Textures of pages with an index of at least the new number of pages are freed
+            void defragment();
+
+        private:
+            detail::TextureAtlasInternal* _internal = nullptr;
+    };
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
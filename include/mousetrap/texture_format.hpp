@@ -0,0 +1,44 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#pragma once
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+namespace mousetrap
+{
+    /// @brief GPU-side storage format of a texture, governs how much video memory a texture occupies and with what precision its colors are stored
+    enum class TextureFormat
+    {
+        /// @brief 8-bit per component RGBA, matches the format of mousetrap::Image
+        RGBA8 = GL_RGBA8,
+
+        /// @brief 8-bit per component RGBA, with the color components interpreted as being in sRGB space. Sampling converts them to linear space
+        SRGB8_ALPHA8 = GL_SRGB8_ALPHA8,
+
+        /// @brief single 8-bit component, only the red component of the source is stored. Useful for masks or scalar data
+        R8 = GL_R8,
+
+        /// @brief two 8-bit components, only the red and green components of the source are stored
+        RG8 = GL_RG8,
+
+        /// @brief 16-bit floating point per component RGBA, for high dynamic range content
+        RGBA16F = GL_RGBA16F,
+
+        /// @brief 32-bit floating point per component RGBA, for high dynamic range content or data
+        RGBA32F = GL_RGBA32F,
+
+        /// @brief compressed RGBA, the compression scheme is chosen by the driver
+        COMPRESSED_RGBA = GL_COMPRESSED_RGBA,
+
+        /// @brief S3TC / DXT5 compressed RGBA, 1 byte per pixel. Falls back to TextureFormat::RGBA8 if unsupported
+        COMPRESSED_RGBA_S3TC = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+
+        /// @brief BPTC / BC7 compressed RGBA, 1 byte per pixel with higher quality than S3TC. Falls back to TextureFormat::RGBA8 if unsupported
+        COMPRESSED_RGBA_BPTC = GL_COMPRESSED_RGBA_BPTC_UNORM
+    };
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
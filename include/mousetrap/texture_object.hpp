@@ -18,6 +18,13 @@ namespace mousetrap
 
         /// @brief unbind from rendering
         virtual void unbind() const = 0;
+
+        /// @brief get version of the texture content, which changes whenever the content or sampling state is modified. Used to detect whether a cached frame is outdated, objects that do not track their modifications always return 0
+        /// @return version
+        virtual uint64_t get_version() const
+        {
+            return 0;
+        }
     };
 }
 
@@ -16,7 +16,16 @@ namespace mousetrap
         NEAREST = GL_NEAREST,
 
         /// @brief linear interpolation
-        LINEAR = GL_LINEAR
+        LINEAR = GL_LINEAR,
+
+        /// @brief nearest neighbor scaling from the closest mip level, the texture generates a mip chain
+        NEAREST_MIPMAP = GL_NEAREST_MIPMAP_NEAREST,
+
+        /// @brief linear interpolation within the closest mip level, the texture generates a mip chain
+        LINEAR_MIPMAP = GL_LINEAR_MIPMAP_NEAREST,
+
+        /// @brief linear interpolation within and between the two closest mip levels, the texture generates a mip chain
+        TRILINEAR = GL_LINEAR_MIPMAP_LINEAR
     };
 }
 
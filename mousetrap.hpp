@@ -39,6 +39,7 @@
 #include <mousetrap/icon.hpp>
 #include <mousetrap/image.hpp>
 #include <mousetrap/image_display.hpp>
+#include <mousetrap/instance_buffer.hpp>
 #include <mousetrap/justify_mode.hpp>
 #include <mousetrap/key_event_controller.hpp>
 #include <mousetrap/key_file.hpp>
@@ -52,6 +53,7 @@
 #include <mousetrap/motion_event_controller.hpp>
 #include <mousetrap/msaa_render_texture.hpp>
 #include <mousetrap/notebook.hpp>
+#include <mousetrap/offscreen_renderer.hpp>
 #include <mousetrap/orientation.hpp>
 #include <mousetrap/orientation.hpp>
 #include <mousetrap/overlay.hpp>
@@ -63,11 +65,17 @@
 #include <mousetrap/progress_bar.hpp>
 #include <mousetrap/relative_position.hpp>
 #include <mousetrap/render_area.hpp>
+#include <mousetrap/render_target_pool.hpp>
 #include <mousetrap/render_task.hpp>
 #include <mousetrap/render_texture.hpp>
 #include <mousetrap/revealer.hpp>
 #include <mousetrap/rotate_event_controller.hpp>
 #include <mousetrap/scale.hpp>
+#include <mousetrap/shader_cache.hpp>
+#include <mousetrap/shader_variant.hpp>
+#include <mousetrap/streaming_texture.hpp>
+#include <mousetrap/texture_atlas.hpp>
+#include <mousetrap/texture_format.hpp>
 #include <mousetrap/texture_scale_mode.hpp>
 #include <mousetrap/scroll_event_controller.hpp>
 #include <mousetrap/scrollbar.hpp>
@@ -37,7 +37,10 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glEnable(GL_BLEND);
+        if (not detail::gl_state_set_blend_mode((int32_t) mode, allow_alpha_blend))
+            return;
+
+        detail::gl_state_set_blend_enabled(mode != NONE);
 
         if (mode == NORMAL)
         {
@@ -136,8 +139,6 @@ namespace mousetrap
                 glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_DST_ALPHA, GL_ONE);
             }
         }
-        else
-            glDisable(GL_BLEND);
     }
 
     std::string blend_mode_to_string(BlendMode mode)
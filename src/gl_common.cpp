@@ -9,6 +9,7 @@
 
 #include <mousetrap/log.hpp>
 #include <iostream>
+#include <limits>
 
 namespace mousetrap
 {
@@ -49,6 +50,166 @@ namespace mousetrap
         auto xy = from_gl_position({in.x, in.y});
         return {xy.x, xy.y, in.z};
     }
+
+    namespace detail
+    {
+        // all render areas share detail::GL_CONTEXT, so a single cache suffices
+        struct GLStateCache
+        {
+            // never a valid handle, so the first bind after invalidation is always issued
+            static inline constexpr GLNativeHandle unknown = std::numeric_limits<GLNativeHandle>::max();
+            static inline constexpr uint64_t n_texture_units = 16;
+
+            GLStateCache()
+            {
+                texture_ids.fill(unknown);
+                sampler_ids.fill(unknown);
+            }
+
+            GLNativeHandle program_id = unknown;
+            GLNativeHandle vertex_array_id = unknown;
+            uint64_t active_texture_unit = unknown;
+            std::array<GLNativeHandle, n_texture_units> texture_ids;
+            std::array<GLNativeHandle, n_texture_units> sampler_ids;
+
+            int32_t blend_mode = -1;
+            bool allow_alpha_blend = true;
+
+            // tracked separately from the mode, BlendMode::NONE disables blending while the mode itself stays cached
+            int32_t blend_enabled = -1;
+        };
+
+        static GLStateCache GL_STATE_CACHE;
+
+        void gl_state_invalidate()
+        {
+            GL_STATE_CACHE = GLStateCache();
+        }
+
+        void gl_state_use_program(GLNativeHandle program_id)
+        {
+            auto& cache = GL_STATE_CACHE;
+            if (cache.program_id == program_id)
+                return;
+
+            glUseProgram(program_id);
+            cache.program_id = program_id;
+        }
+
+        void gl_state_bind_vertex_array(GLNativeHandle vertex_array_id)
+        {
+            auto& cache = GL_STATE_CACHE;
+            if (cache.vertex_array_id == vertex_array_id)
+                return;
+
+            glBindVertexArray(vertex_array_id);
+            cache.vertex_array_id = vertex_array_id;
+        }
+
+        void gl_state_bind_texture(uint64_t texture_unit, GLNativeHandle texture_id)
+        {
+            auto& cache = GL_STATE_CACHE;
+
+            if (cache.active_texture_unit != texture_unit)
+            {
+                glActiveTexture(GL_TEXTURE0 + texture_unit);
+                cache.active_texture_unit = texture_unit;
+            }
+
+            if (texture_unit >= cache.n_texture_units)
+            {
+                glBindTexture(GL_TEXTURE_2D, texture_id);
+                return;
+            }
+
+            if (cache.texture_ids.at(texture_unit) != texture_id)
+            {
+                glBindTexture(GL_TEXTURE_2D, texture_id);
+                cache.texture_ids.at(texture_unit) = texture_id;
+            }
+        }
+
+        void gl_state_bind_sampler(uint64_t texture_unit, GLNativeHandle sampler_id)
+        {
+            auto& cache = GL_STATE_CACHE;
+            if (texture_unit >= cache.n_texture_units)
+            {
+                glBindSampler(texture_unit, sampler_id);
+                return;
+            }
+
+            if (cache.sampler_ids.at(texture_unit) != sampler_id)
+            {
+                glBindSampler(texture_unit, sampler_id);
+                cache.sampler_ids.at(texture_unit) = sampler_id;
+            }
+        }
+
+        bool gl_state_set_blend_mode(int32_t blend_mode, bool allow_alpha_blend)
+        {
+            auto& cache = GL_STATE_CACHE;
+            if (cache.blend_mode == blend_mode and cache.allow_alpha_blend == allow_alpha_blend)
+                return false;
+
+            cache.blend_mode = blend_mode;
+            cache.allow_alpha_blend = allow_alpha_blend;
+            return true;
+        }
+
+        void gl_state_set_blend_enabled(bool b)
+        {
+            auto& cache = GL_STATE_CACHE;
+            if (cache.blend_enabled == (b ? 1 : 0))
+                return;
+
+            if (b)
+                glEnable(GL_BLEND);
+            else
+                glDisable(GL_BLEND);
+
+            cache.blend_enabled = b ? 1 : 0;
+        }
+
+        void gl_state_forget_program(GLNativeHandle program_id)
+        {
+            auto& cache = GL_STATE_CACHE;
+            if (cache.program_id == program_id)
+                cache.program_id = cache.unknown;
+        }
+
+        void gl_state_forget_vertex_array(GLNativeHandle vertex_array_id)
+        {
+            auto& cache = GL_STATE_CACHE;
+            if (cache.vertex_array_id == vertex_array_id)
+                cache.vertex_array_id = cache.unknown;
+        }
+
+        void gl_state_forget_texture(GLNativeHandle texture_id)
+        {
+            auto& cache = GL_STATE_CACHE;
+            for (auto& id : cache.texture_ids)
+                if (id == texture_id)
+                    id = cache.unknown;
+        }
+
+        static GLStatistics GL_STATISTICS;
+
+        GLStatistics gl_statistics_get()
+        {
+            return GL_STATISTICS;
+        }
+
+        void gl_statistics_count_draw(uint64_t n_vertices)
+        {
+            GL_STATISTICS.n_draw_calls += 1;
+            GL_STATISTICS.n_vertices += n_vertices;
+        }
+
+        void gl_statistics_count_upload(uint64_t n_bytes)
+        {
+            GL_STATISTICS.n_bytes_uploaded += n_bytes;
+        }
+    }
 }
 
 #endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
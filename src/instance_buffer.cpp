@@ -0,0 +1,326 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/instance_buffer.hpp>
+#include <mousetrap/render_area.hpp>
+#include <mousetrap/log.hpp>
+
+#include <sstream>
+#include <cstring>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        DECLARE_NEW_TYPE(InstanceBufferInternal, instance_buffer_internal, INSTANCE_BUFFER_INTERNAL)
+
+        static void instance_buffer_internal_finalize(GObject* object)
+        {
+            auto* self = MOUSETRAP_INSTANCE_BUFFER_INTERNAL(object);
+            G_OBJECT_CLASS(instance_buffer_internal_parent_class)->finalize(object);
+
+            if (detail::is_opengl_disabled())
+                return;
+
+            if (self->buffer_id != 0)
+                glDeleteBuffers(1, &self->buffer_id);
+
+            delete self->instance_data;
+        }
+
+        DEFINE_NEW_TYPE_TRIVIAL_INIT(InstanceBufferInternal, instance_buffer_internal, INSTANCE_BUFFER_INTERNAL)
+        DEFINE_NEW_TYPE_TRIVIAL_CLASS_INIT(InstanceBufferInternal, instance_buffer_internal, INSTANCE_BUFFER_INTERNAL)
+
+        static InstanceBufferInternal* instance_buffer_internal_new()
+        {
+            auto* self = (InstanceBufferInternal*) g_object_new(instance_buffer_internal_get_type(), nullptr);
+            instance_buffer_internal_init(self);
+
+            if (detail::is_opengl_disabled())
+            {
+                log::critical("In instance_buffer_internal_new: Trying to instantiate mousetrap::InstanceBuffer, but the OpenGL component is disabled", MOUSETRAP_DOMAIN);
+                return self;
+            }
+
+            detail::make_opengl_context_current();
+            glGenBuffers(1, &self->buffer_id);
+
+            self->instance_data = new std::vector<InstanceInfo>();
+            self->buffer_size = 0;
+            self->dirty_first = 0;
+            self->dirty_last = 0;
+            self->version = render_state_next_version();
+
+            return self;
+        }
+
+        static void instance_info_set_transform(InstanceInfo& info, const GLTransform& transform)
+        {
+            std::memcpy(info._transform, &(transform.transform[0][0]), sizeof(info._transform));
+        }
+
+        static void instance_info_set_color(InstanceInfo& info, RGBA color)
+        {
+            info._color[0] = color.r;
+            info._color[1] = color.g;
+            info._color[2] = color.b;
+            info._color[3] = color.a;
+        }
+
+        static void instance_info_set_texture_rectangle(InstanceInfo& info, const Rectangle& rectangle)
+        {
+            info._texture_rectangle[0] = rectangle.top_left.x;
+            info._texture_rectangle[1] = rectangle.top_left.y;
+            info._texture_rectangle[2] = rectangle.size.x;
+            info._texture_rectangle[3] = rectangle.size.y;
+        }
+
+        static InstanceInfo instance_info_from(const Instance& instance)
+        {
+            InstanceInfo out;
+            instance_info_set_transform(out, instance.transform);
+            instance_info_set_color(out, instance.color);
+            instance_info_set_texture_rectangle(out, instance.texture_rectangle);
+            return out;
+        }
+
+        void instance_buffer_internal_update(InstanceBufferInternal* self)
+        {
+            auto n_instances = self->instance_data->size();
+            auto first = self->dirty_first;
+            auto last = std::min<uint64_t>(self->dirty_last, n_instances);
+
+            self->dirty_first = 0;
+            self->dirty_last = 0;
+
+            if (n_instances != self->buffer_size)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, self->buffer_id);
+                glBufferData(GL_ARRAY_BUFFER, n_instances * sizeof(InstanceInfo), self->instance_data->data(), GL_DYNAMIC_DRAW);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                gl_statistics_count_upload(n_instances * sizeof(InstanceInfo));
+
+                self->buffer_size = n_instances;
+                return;
+            }
+
+            if (first >= last)
+                return;
+
+            glBindBuffer(GL_ARRAY_BUFFER, self->buffer_id);
+
+            if ((last - first) * 2 > n_instances)
+            {
+                glBufferData(GL_ARRAY_BUFFER, n_instances * sizeof(InstanceInfo), self->instance_data->data(), GL_DYNAMIC_DRAW);
+                gl_statistics_count_upload(n_instances * sizeof(InstanceInfo));
+            }
+            else
+            {
+                glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(InstanceInfo), (last - first) * sizeof(InstanceInfo), self->instance_data->data() + first);
+                gl_statistics_count_upload((last - first) * sizeof(InstanceInfo));
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
+
+    InstanceBuffer::InstanceBuffer()
+    {
+        if (detail::is_opengl_disabled())
+        {
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = detail::instance_buffer_internal_new();
+    }
+
+    InstanceBuffer::InstanceBuffer(const std::vector<Instance>& instances)
+        : InstanceBuffer()
+    {
+        set_instances(instances);
+    }
+
+    InstanceBuffer::InstanceBuffer(detail::InstanceBufferInternal* internal)
+    {
+        if (detail::is_opengl_disabled())
+        {
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = g_object_ref(internal);
+    }
+
+    InstanceBuffer::~InstanceBuffer()
+    {
+        if (not detail::is_opengl_disabled())
+            g_object_unref(_internal);
+    }
+
+    NativeObject InstanceBuffer::get_internal() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return G_OBJECT(_internal);
+    }
+
+    InstanceBuffer::operator NativeObject() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return G_OBJECT(_internal);
+    }
+
+    void InstanceBuffer::queue_update(uint64_t first, uint64_t last)
+    {
+        if (first >= last)
+            return;
+
+        _internal->version = detail::render_state_next_version();
+
+        if (_internal->dirty_first >= _internal->dirty_last)
+        {
+            _internal->dirty_first = first;
+            _internal->dirty_last = last;
+        }
+        else
+        {
+            _internal->dirty_first = std::min(_internal->dirty_first, first);
+            _internal->dirty_last = std::max(_internal->dirty_last, last);
+        }
+    }
+
+    void InstanceBuffer::set_instances(const std::vector<Instance>& instances)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->instance_data->resize(instances.size());
+        set_instances(0, instances.data(), instances.size());
+    }
+
+    void InstanceBuffer::set_instances(uint64_t first, const Instance* data, uint64_t n)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto& instances = *_internal->instance_data;
+        if (first + n > instances.size())
+            resize(first + n);
+
+        for (uint64_t i = 0; i < n; ++i)
+            instances[first + i] = detail::instance_info_from(data[i]);
+
+        queue_update(first, first + n);
+    }
+
+    void InstanceBuffer::set_transforms(uint64_t first, const GLTransform* data, uint64_t n)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto& instances = *_internal->instance_data;
+        if (first + n > instances.size())
+            resize(first + n);
+
+        for (uint64_t i = 0; i < n; ++i)
+            detail::instance_info_set_transform(instances[first + i], data[i]);
+
+        queue_update(first, first + n);
+    }
+
+    void InstanceBuffer::set_colors(uint64_t first, const RGBA* data, uint64_t n)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto& instances = *_internal->instance_data;
+        if (first + n > instances.size())
+            resize(first + n);
+
+        for (uint64_t i = 0; i < n; ++i)
+            detail::instance_info_set_color(instances[first + i], data[i]);
+
+        queue_update(first, first + n);
+    }
+
+    void InstanceBuffer::set_instance(uint64_t i, const Instance& instance)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        if (i >= _internal->instance_data->size())
+        {
+            std::stringstream str;
+            str << "In InstanceBuffer::set_instance: index " << i << " out of bounds for a buffer with " << _internal->instance_data->size() << " instances";
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        _internal->instance_data->at(i) = detail::instance_info_from(instance);
+        queue_update(i, i + 1);
+    }
+
+    Instance InstanceBuffer::get_instance(uint64_t i) const
+    {
+        if (detail::is_opengl_disabled())
+            return Instance();
+
+        if (i >= _internal->instance_data->size())
+        {
+            std::stringstream str;
+            str << "In InstanceBuffer::get_instance: index " << i << " out of bounds for a buffer with " << _internal->instance_data->size() << " instances";
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return Instance();
+        }
+
+        const auto& info = _internal->instance_data->at(i);
+
+        auto out = Instance();
+        std::memcpy(&(out.transform.transform[0][0]), info._transform, sizeof(info._transform));
+        out.color = RGBA(info._color[0], info._color[1], info._color[2], info._color[3]);
+        out.texture_rectangle = Rectangle{
+            {info._texture_rectangle[0], info._texture_rectangle[1]},
+            {info._texture_rectangle[2], info._texture_rectangle[3]}
+        };
+        return out;
+    }
+
+    void InstanceBuffer::resize(uint64_t n_instances)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto before = _internal->instance_data->size();
+        _internal->instance_data->resize(n_instances, detail::instance_info_from(Instance()));
+        _internal->version = detail::render_state_next_version();
+
+        if (n_instances > before)
+            queue_update(before, n_instances);
+    }
+
+    uint64_t InstanceBuffer::get_n_instances() const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return _internal->instance_data->size();
+    }
+
+    GLNativeHandle InstanceBuffer::get_native_handle() const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return _internal->buffer_id;
+    }
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
@@ -23,16 +23,93 @@ namespace mousetrap
             if (internal->buffer != 0)
                 glDeleteFramebuffers(1, &internal->buffer);
 
-            if (internal->msaa_color_buffer_texture != 0)
-                glDeleteTextures(1, &internal->msaa_color_buffer_texture);
-
             if (internal->intermediate_buffer != 0)
                 glDeleteFramebuffers(1, &internal->intermediate_buffer);
 
-            if (internal->screen_texture != 0)
-                glDeleteTextures(1, &internal->screen_texture);
+            // attachments are owned by the pool, which may hand them to another render target
+            render_target_pool_release(internal->msaa_allocation);
+            render_target_pool_release(internal->screen_allocation);
+
+            internal->buffer = 0;
+            internal->intermediate_buffer = 0;
+            internal->msaa_allocation = nullptr;
+            internal->screen_allocation = nullptr;
+            internal->msaa_color_buffer_texture = 0;
+            internal->screen_texture = 0;
+        }
+
+        // get attachments that fit the current size from the pool, framebuffers are only re-attached if the pool handed out different attachments
+        // the resolve target is only allocated once the image is needed as a texture, presenting it through a blit does not need it
+        // new attachments hold undefined content, so resizing existing ones only happens on create, which clears them. Otherwise only a missing resolve target is allocated
+        static void multisampled_render_texture_internal_fit(MultisampledRenderTextureInternal* self, bool needs_screen_texture, bool resize)
+        {
+            auto size = Vector2i(self->width, self->height);
+
+            GLint before = 0;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &before);
+
+            auto* msaa = resize or self->msaa_allocation == nullptr ? render_target_pool_resize(self->msaa_allocation, size, self->n_samples, self->bucketed) : self->msaa_allocation;
+            if (msaa != self->msaa_allocation)
+            {
+                self->msaa_allocation = msaa;
+                self->msaa_color_buffer_texture = msaa->texture;
+
+                if (self->buffer == 0)
+                    glGenFramebuffers(1, &self->buffer);
+
+                glBindFramebuffer(GL_FRAMEBUFFER, self->buffer);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, self->msaa_color_buffer_texture, 0);
+                self->version = render_state_next_version();
+            }
+
+            if ((needs_screen_texture and self->screen_allocation == nullptr) or (resize and self->screen_allocation != nullptr))
+            {
+                auto* screen = render_target_pool_resize(self->screen_allocation, size, 0, self->bucketed);
+                if (screen != self->screen_allocation)
+                {
+                    self->screen_allocation = screen;
+                    self->screen_texture = screen->texture;
+                    self->screen_texture_dirty = true;
+
+                    if (self->intermediate_buffer == 0)
+                        glGenFramebuffers(1, &self->intermediate_buffer);
+
+                    glBindFramebuffer(GL_FRAMEBUFFER, self->intermediate_buffer);
+                    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, self->screen_texture, 0);	// we only need a color buffer
+                    self->version = render_state_next_version();
+                }
+            }
+
+            glBindFramebuffer(GL_FRAMEBUFFER, before);
+        }
+
+        // blit the multi-sampled buffer into a single-sampled framebuffer, which resolves it. Leaves both read and draw binding at the target
+        static void multisampled_render_texture_internal_blit(MultisampledRenderTextureInternal* self, GLint target)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, self->buffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+            glBlitFramebuffer(0, 0, self->width, self->height, 0, 0, self->width, self->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, target);
         }
-        
+
+        void multisampled_render_texture_internal_resolve(MultisampledRenderTextureInternal* self)
+        {
+            if (self->buffer == 0)
+                return;
+
+            multisampled_render_texture_internal_fit(self, true, false);
+            if (not self->screen_texture_dirty)
+                return;
+
+            GLint before = 0;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &before);
+
+            multisampled_render_texture_internal_blit(self, self->intermediate_buffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, before);
+
+            self->screen_texture_dirty = false;
+        }
+
         DECLARE_NEW_TYPE(MultisampledRenderTextureInternal, multisampled_render_texture_internal, MULTISAMPLED_RENDER_TEXTURE_INTERNAL)
 
         static void multisampled_render_texture_internal_finalize(GObject* object)
@@ -49,7 +126,21 @@ namespace mousetrap
         {
             auto* self = (MultisampledRenderTextureInternal*) g_object_new(multisampled_render_texture_internal_get_type(), nullptr);
             multisampled_render_texture_internal_init(self);
-            
+
+            self->n_samples = 0;
+            self->width = 0;
+            self->height = 0;
+            self->before_buffer = 0;
+            self->buffer = 0;
+            self->msaa_color_buffer_texture = 0;
+            self->intermediate_buffer = 0;
+            self->screen_texture = 0;
+            self->msaa_allocation = nullptr;
+            self->screen_allocation = nullptr;
+            self->screen_texture_dirty = false;
+            self->bucketed = false;
+            self->version = 0;
+
             return self;
         }
     }
@@ -101,36 +192,23 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        free();
-
         _internal->width = width;
         _internal->height = height;
 
+        // only allocates if the new size does not fit into the current attachments, this is also the only place oversized attachments are shrunk
+        detail::multisampled_render_texture_internal_fit(_internal, false, true);
+
+        // attachments may be reused, so they have to be cleared explicitly. The resolve target picks this up on its next resolve
+        static const GLfloat transparent[4] = {0, 0, 0, 0};
         GLint before = 0;
         glGetIntegerv(GL_FRAMEBUFFER_BINDING, &before);
 
-        glGenFramebuffers(1, &_internal->buffer);
         glBindFramebuffer(GL_FRAMEBUFFER, _internal->buffer);
-
-        glGenTextures(1, &_internal->msaa_color_buffer_texture);
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, _internal->msaa_color_buffer_texture);
-        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, _internal->n_samples, GL_RGBA, width, height, GL_TRUE);
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, _internal->msaa_color_buffer_texture, 0);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        glGenFramebuffers(1, &_internal->intermediate_buffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, _internal->intermediate_buffer);
-
-        glGenTextures(1, &_internal->screen_texture);
-        glBindTexture(GL_TEXTURE_2D, _internal->screen_texture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _internal->screen_texture, 0);	// we only need a color buffer
+        glClearBufferfv(GL_COLOR, 0, transparent);
 
         glBindFramebuffer(GL_FRAMEBUFFER, before);
+        _internal->screen_texture_dirty = true;
+        _internal->version = detail::render_state_next_version();
     }
 
     void MultisampledRenderTexture::bind_as_render_target() const
@@ -145,6 +223,7 @@ namespace mousetrap
 
         glGetIntegerv(GL_FRAMEBUFFER_BINDING, &_internal->before_buffer);
         glBindFramebuffer(GL_FRAMEBUFFER, _internal->buffer);
+        _internal->screen_texture_dirty = true;
     }
 
     void MultisampledRenderTexture::unbind_as_render_target() const
@@ -152,10 +231,61 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, _internal->buffer);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _internal->intermediate_buffer);
-        glBlitFramebuffer(0, 0, _internal->width, _internal->height, 0, 0, _internal->width, _internal->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        detail::multisampled_render_texture_internal_fit(_internal, true, false);
+        detail::multisampled_render_texture_internal_blit(_internal, _internal->intermediate_buffer);
         glBindFramebuffer(GL_FRAMEBUFFER, _internal->before_buffer);
+
+        _internal->screen_texture_dirty = false;
+        _internal->version = detail::render_state_next_version();
+    }
+
+    void MultisampledRenderTexture::unbind_as_render_target_and_resolve() const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::multisampled_render_texture_internal_blit(_internal, _internal->before_buffer);
+        _internal->version = detail::render_state_next_version();
+    }
+
+    void MultisampledRenderTexture::resolve_to_current_render_target() const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        if (_internal->buffer == 0)
+            return;
+
+        GLint current = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &current);
+        detail::multisampled_render_texture_internal_blit(_internal, current);
+    }
+
+    Image MultisampledRenderTexture::download() const
+    {
+        if (detail::is_opengl_disabled())
+            return Image();
+
+        auto out = Image();
+        out.create(_internal->width, _internal->height);
+
+        detail::multisampled_render_texture_internal_resolve(_internal);
+        if (_internal->intermediate_buffer == 0)
+            return out;
+
+        // the attachment may be larger than the texture, so only the region covered by it is read
+        detail::texture_internal_read_framebuffer(_internal->intermediate_buffer, GL_COLOR_ATTACHMENT0, Vector2i(_internal->width, _internal->height), out.data());
+        return out;
+    }
+
+    Rectangle MultisampledRenderTexture::get_texture_rectangle() const
+    {
+        if (detail::is_opengl_disabled())
+            return Rectangle{{0, 0}, {1, 1}};
+
+        // both attachments share the same bucket, so the multi-sampled one can stand in while the resolve target is not allocated
+        auto* allocation = _internal->screen_allocation != nullptr ? _internal->screen_allocation : _internal->msaa_allocation;
+        return detail::render_target_pool_get_texture_rectangle(allocation, Vector2i(_internal->width, _internal->height));
     }
 
     void MultisampledRenderTexture::bind() const
@@ -163,8 +293,11 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, _internal->screen_texture);
+        detail::multisampled_render_texture_internal_resolve(_internal);
+
+        // filtering is set on the texture itself, so no sampler may override it
+        detail::gl_state_bind_texture(0, _internal->screen_texture);
+        detail::gl_state_bind_sampler(0, 0);
     }
 
     void MultisampledRenderTexture::unbind() const
@@ -172,7 +305,15 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+        detail::gl_state_bind_texture(0, 0);
+    }
+
+    uint64_t MultisampledRenderTexture::get_version() const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return _internal->version;
     }
 
     MultisampledRenderTexture::operator GObject*() const
@@ -188,17 +329,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        if (_internal->buffer != 0)
-            glDeleteFramebuffers(1, &_internal->buffer);
-
-        if (_internal->msaa_color_buffer_texture != 0)
-            glDeleteTextures(1, &_internal->msaa_color_buffer_texture);
-
-        if (_internal->intermediate_buffer != 0)
-            glDeleteFramebuffers(1, &_internal->intermediate_buffer);
-
-        if (_internal->screen_texture != 0)
-            glDeleteTextures(1, &_internal->screen_texture);
+        detail::multisampled_render_texture_internal_free(_internal);
     }
 }
 
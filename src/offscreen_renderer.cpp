@@ -0,0 +1,291 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/offscreen_renderer.hpp>
+#include <mousetrap/render_area.hpp>
+#include <mousetrap/blend_mode.hpp>
+#include <mousetrap/log.hpp>
+
+#include <sstream>
+
+#if MOUSETRAP_ENABLE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        #if MOUSETRAP_ENABLE_EGL
+        static EGLDisplay HEADLESS_DISPLAY = EGL_NO_DISPLAY;
+        static EGLContext HEADLESS_CONTEXT = EGL_NO_CONTEXT;
+        #endif
+
+        bool initialize_opengl_headless()
+        {
+            if (mousetrap::GL_INITIALIZED)
+                return not detail::is_opengl_disabled();
+
+            mousetrap::GL_INITIALIZED = true;
+
+            #if MOUSETRAP_ENABLE_EGL
+            {
+                EGLDisplay display = EGL_NO_DISPLAY;
+                EGLConfig config = nullptr;
+                EGLint n_configs = 0;
+                EGLint major = 0, minor = 0;
+                EGLContext context = EGL_NO_CONTEXT;
+                GLenum glew_error = 0;
+
+                // surfaceless platform needs neither X11 nor wayland, fall back to the default display if it is unavailable
+                auto* get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+                if (get_platform_display != nullptr)
+                    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+                if (display == EGL_NO_DISPLAY)
+                    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+                if (display == EGL_NO_DISPLAY or eglInitialize(display, &major, &minor) != EGL_TRUE)
+                {
+                    log::warning("In initialize_opengl_headless: Unable to initialize EGL display", MOUSETRAP_DOMAIN);
+                    goto failed;
+                }
+
+                if (eglBindAPI(EGL_OPENGL_API) != EGL_TRUE)
+                {
+                    log::warning("In initialize_opengl_headless: EGL implementation does not support desktop OpenGL", MOUSETRAP_DOMAIN);
+                    goto failed;
+                }
+
+                {
+                    EGLint config_attributes[] = {
+                        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                        EGL_RED_SIZE, 8,
+                        EGL_GREEN_SIZE, 8,
+                        EGL_BLUE_SIZE, 8,
+                        EGL_ALPHA_SIZE, 8,
+                        EGL_NONE
+                    };
+
+                    if (eglChooseConfig(display, config_attributes, &config, 1, &n_configs) != EGL_TRUE or n_configs == 0)
+                    {
+                        log::warning("In initialize_opengl_headless: No suitable EGL config", MOUSETRAP_DOMAIN);
+                        goto failed;
+                    }
+
+                    EGLint context_attributes[] = {
+                        EGL_CONTEXT_MAJOR_VERSION, 3,
+                        EGL_CONTEXT_MINOR_VERSION, 3,
+                        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                        EGL_NONE
+                    };
+
+                    context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+                }
+
+                if (context == EGL_NO_CONTEXT)
+                {
+                    log::warning("In initialize_opengl_headless: Unable to create OpenGL 3.3 context", MOUSETRAP_DOMAIN);
+                    goto failed;
+                }
+
+                if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) != EGL_TRUE)
+                {
+                    log::warning("In initialize_opengl_headless: Unable to make context current, EGL_KHR_surfaceless_context may not be supported", MOUSETRAP_DOMAIN);
+                    eglDestroyContext(display, context);
+                    goto failed;
+                }
+
+                glewExperimental = GL_FALSE;
+                glew_error = glewInit();
+
+                // GLX-based builds of GLEW report a missing X11 display after all core functions were already loaded
+                if (glew_error != GLEW_NO_ERROR and glew_error != GLEW_ERROR_NO_GLX_DISPLAY)
+                {
+                    std::stringstream str;
+                    str << "In glewInit: Unable to initialize glew " << "(" << glew_error << ")";
+                    log::warning(str.str(), MOUSETRAP_DOMAIN);
+                    eglDestroyContext(display, context);
+                    goto failed;
+                }
+
+                HEADLESS_DISPLAY = display;
+                HEADLESS_CONTEXT = context;
+                detail::GL_CONTEXT_IS_HEADLESS = true;
+                return true;
+
+                failed:
+                log::critical("In initialize_opengl_headless: Unable to create headless OpenGL context, disabling the OpenGL component", MOUSETRAP_DOMAIN);
+                if (display != EGL_NO_DISPLAY)
+                    eglTerminate(display);
+
+                return false;
+            }
+            #else
+            log::critical("In initialize_opengl_headless: mousetrap was compiled without EGL support, headless rendering is unavailable", MOUSETRAP_DOMAIN);
+            return false;
+            #endif
+        }
+
+        void make_headless_opengl_context_current()
+        {
+            #if MOUSETRAP_ENABLE_EGL
+            if (HEADLESS_CONTEXT != EGL_NO_CONTEXT and eglGetCurrentContext() != HEADLESS_CONTEXT)
+                eglMakeCurrent(HEADLESS_DISPLAY, EGL_NO_SURFACE, EGL_NO_SURFACE, HEADLESS_CONTEXT);
+            #endif
+        }
+
+        DECLARE_NEW_TYPE(OffscreenRendererInternal, offscreen_renderer_internal, OFFSCREEN_RENDERER_INTERNAL)
+
+        static void offscreen_renderer_internal_finalize(GObject* object)
+        {
+            auto* self = MOUSETRAP_OFFSCREEN_RENDERER_INTERNAL(object);
+            G_OBJECT_CLASS(offscreen_renderer_internal_parent_class)->finalize(object);
+
+            if (detail::is_opengl_disabled())
+                return;
+
+            detail::make_opengl_context_current();
+            delete self->render_texture;
+        }
+
+        DEFINE_NEW_TYPE_TRIVIAL_INIT(OffscreenRendererInternal, offscreen_renderer_internal, OFFSCREEN_RENDERER_INTERNAL)
+        DEFINE_NEW_TYPE_TRIVIAL_CLASS_INIT(OffscreenRendererInternal, offscreen_renderer_internal, OFFSCREEN_RENDERER_INTERNAL)
+
+        static OffscreenRendererInternal* offscreen_renderer_internal_new(uint64_t width, uint64_t height)
+        {
+            auto* self = (OffscreenRendererInternal*) g_object_new(offscreen_renderer_internal_get_type(), nullptr);
+            offscreen_renderer_internal_init(self);
+
+            detail::make_opengl_context_current();
+
+            self->render_texture = new RenderTexture();
+            self->render_texture->create(width, height);
+            self->size = Vector2i(width, height);
+            self->clear_color = RGBA(0, 0, 0, 0);
+
+            return self;
+        }
+    }
+
+    OffscreenRenderer::OffscreenRenderer(uint64_t width, uint64_t height)
+    {
+        if (not initialize())
+        {
+            log::critical("In OffscreenRenderer(): trying to instantiate OffscreenRenderer, but the OpenGL component is disabled.", MOUSETRAP_DOMAIN);
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = detail::offscreen_renderer_internal_new(width, height);
+    }
+
+    OffscreenRenderer::OffscreenRenderer(detail::OffscreenRendererInternal* internal)
+    {
+        if (detail::is_opengl_disabled())
+        {
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = g_object_ref(internal);
+    }
+
+    OffscreenRenderer::~OffscreenRenderer()
+    {
+        if (not detail::is_opengl_disabled())
+            g_object_unref(_internal);
+    }
+
+    NativeObject OffscreenRenderer::get_internal() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return G_OBJECT(_internal);
+    }
+
+    OffscreenRenderer::operator NativeObject() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return G_OBJECT(_internal);
+    }
+
+    bool OffscreenRenderer::initialize()
+    {
+        return detail::initialize_opengl_headless();
+    }
+
+    void OffscreenRenderer::resize(uint64_t width, uint64_t height)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::make_opengl_context_current();
+        _internal->render_texture->create(width, height);
+        _internal->size = Vector2i(width, height);
+    }
+
+    Vector2i OffscreenRenderer::get_size() const
+    {
+        if (detail::is_opengl_disabled())
+            return {0, 0};
+
+        return _internal->size;
+    }
+
+    void OffscreenRenderer::set_clear_color(RGBA color)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->clear_color = color;
+    }
+
+    RGBA OffscreenRenderer::get_clear_color() const
+    {
+        if (detail::is_opengl_disabled())
+            return RGBA(0, 0, 0, 0);
+
+        return _internal->clear_color;
+    }
+
+    Image OffscreenRenderer::render(const std::vector<RenderTask>& tasks)
+    {
+        if (detail::is_opengl_disabled())
+            return Image();
+
+        detail::make_opengl_context_current();
+        detail::gl_state_invalidate();
+
+        _internal->render_texture->bind_as_render_target();
+        glViewport(0, 0, _internal->size.x, _internal->size.y);
+
+        auto color = _internal->clear_color;
+        glClearColor(color.r, color.g, color.b, color.a);
+        glClear(GL_COLOR_BUFFER_BIT);
+        set_current_blend_mode(BlendMode::NORMAL);
+
+        for (auto& task : tasks)
+            task.render();
+
+        _internal->render_texture->unbind_as_render_target();
+
+        // row 0 of the framebuffer is the bottom of the frame, while row 0 of an image is the top
+        return _internal->render_texture->download().as_flipped(false, true);
+    }
+
+    RenderTexture& OffscreenRenderer::get_render_texture() const
+    {
+        return *_internal->render_texture;
+    }
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
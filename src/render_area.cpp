@@ -9,8 +9,13 @@
 #include <mousetrap/render_area.hpp>
 #include <mousetrap/render_task.hpp>
 #include <mousetrap/msaa_render_texture.hpp>
+#include <mousetrap/render_texture.hpp>
 #include <mousetrap/shape.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace mousetrap
 {
     namespace detail
@@ -119,7 +124,15 @@ namespace mousetrap
 
         bool is_opengl_disabled()
         {
-            return (mousetrap::GL_INITIALIZED == false or detail::GL_CONTEXT == nullptr);
+            return (mousetrap::GL_INITIALIZED == false or (detail::GL_CONTEXT == nullptr and not detail::GL_CONTEXT_IS_HEADLESS));
+        }
+
+        void make_opengl_context_current()
+        {
+            if (detail::GL_CONTEXT_IS_HEADLESS)
+                make_headless_opengl_context_current();
+            else if (detail::GL_CONTEXT != nullptr)
+                gdk_gl_context_make_current(detail::GL_CONTEXT);
         }
     }
 
@@ -135,18 +148,110 @@ namespace mousetrap
             if (detail::is_opengl_disabled())
                 return;
 
-            for (auto* task : *self->tasks)
-                g_object_unref(task);
+            // shapes may outlive the area, so it has to unregister itself
+            for (auto& pair : *self->shape_to_tasks)
+                pair.first->indexing_areas->erase(self);
+
+            for (auto& pair : *self->tasks)
+                g_object_unref(pair.second.task);
 
             delete self->tasks;
+            delete self->task_to_key;
+            delete self->spatial_cells;
+            delete self->spatial_entries;
+            delete self->spatial_oversized;
+            delete self->shape_to_tasks;
+            delete self->spatial_moved;
+            delete self->sorted_layers;
+            delete self->sort_outdated;
+            delete self->draw_order;
             delete self->render_texture;
             delete self->render_texture_shape;
             delete self->render_texture_shape_task;
+            delete self->render_texture_shader;
+            delete self->frame_cache;
+
+            if (self->batch_vertex_array_id != 0)
+            {
+                detail::gl_state_forget_vertex_array(self->batch_vertex_array_id);
+                glDeleteVertexArrays(1, &self->batch_vertex_array_id);
+            }
+
+            if (self->batch_vertex_buffer_id != 0)
+                glDeleteBuffers(1, &self->batch_vertex_buffer_id);
+
+            if (self->batch_element_buffer_id != 0)
+                glDeleteBuffers(1, &self->batch_element_buffer_id);
+
+            delete self->batch_vertices;
+            delete self->batch_indices;
+
+            for (auto& pending : *self->pending_statistics)
+                self->timestamp_query_pool->insert(self->timestamp_query_pool->end(), pending.timestamps.begin(), pending.timestamps.end());
+
+            if (self->current_statistics != nullptr)
+                self->timestamp_query_pool->insert(self->timestamp_query_pool->end(), self->current_statistics->timestamps.begin(), self->current_statistics->timestamps.end());
+
+            if (not self->timestamp_query_pool->empty())
+                glDeleteQueries(self->timestamp_query_pool->size(), self->timestamp_query_pool->data());
+
+            delete self->statistics;
+            delete self->current_statistics;
+            delete self->pending_statistics;
+            delete self->timestamp_query_pool;
         }
 
         DEFINE_NEW_TYPE_TRIVIAL_INIT(RenderAreaInternal, render_area_internal, RENDER_AREA_INTERNAL)
         DEFINE_NEW_TYPE_TRIVIAL_CLASS_INIT(RenderAreaInternal, render_area_internal, RENDER_AREA_INTERNAL)
 
+        // create task that draws a texture the frame was rendered into over the entire area, multi-sampled frames are blit instead
+        static void render_area_internal_create_present_task(RenderAreaInternal* self, const TextureObject* texture)
+        {
+            self->render_texture_shape = new Shape();
+            self->render_texture_shape->as_rectangle({-1, 1}, {2, 2});
+            self->render_texture_shape->set_texture(texture);
+
+            static const std::string RENDER_TEXTURE_SHADER_SOURCE = R"(
+                #version 130
+
+                in vec4 _vertex_color;
+                in vec2 _texture_coordinates;
+                in vec3 _vertex_position;
+
+                out vec4 _fragment_color;
+
+                uniform int _texture_set;
+                uniform sampler2D _texture;
+
+                void main()
+                {
+                    _fragment_color = texture2D(_texture, _texture_coordinates) * _vertex_color;
+                }
+            )";
+
+            self->render_texture_shader = new Shader();
+            self->render_texture_shader->create_from_string(ShaderType::FRAGMENT, RENDER_TEXTURE_SHADER_SOURCE);
+
+            self->render_texture_shape_task = new RenderTask(*self->render_texture_shape, self->render_texture_shader);
+        }
+
+        // map the quad the frame is presented with onto the region of the pooled render target that holds the frame
+        static void render_area_internal_update_present_task(RenderAreaInternal* self)
+        {
+            auto rectangle = self->frame_cache->get_texture_rectangle();
+            auto size = rectangle.size;
+
+            // render targets are stored bottom to top, so the top of the quad samples the end of the region
+            auto& shape = *self->render_texture_shape;
+            if (shape.get_vertex_texture_coordinate(0) == Vector2f(0, size.y) and shape.get_vertex_texture_coordinate(2) == Vector2f(size.x, 0))
+                return;
+
+            shape.set_vertex_texture_coordinate(0, {0, size.y});
+            shape.set_vertex_texture_coordinate(1, {size.x, size.y});
+            shape.set_vertex_texture_coordinate(2, {size.x, 0});
+            shape.set_vertex_texture_coordinate(3, {0, 0});
+        }
+
         static RenderAreaInternal* render_area_internal_new(GtkGLArea* area, int32_t msaa_samples)
         {
             auto* self = (RenderAreaInternal*) g_object_new(render_area_internal_get_type(), nullptr);
@@ -159,242 +264,1408 @@ namespace mousetrap
             }
 
             self->native = area;
-            self->tasks = new std::vector<detail::RenderTaskInternal*>();
+            self->tasks = new std::map<std::pair<int32_t, uint64_t>, RenderQueueEntry>();
+            self->task_to_key = new std::unordered_multimap<detail::RenderTaskInternal*, std::pair<int32_t, uint64_t>>();
+            self->task_sequence = 0;
+
+            self->culling_enabled = true;
+
+            self->spatial_cells = new std::unordered_map<uint64_t, std::vector<detail::RenderTaskInternal*>>();
+            self->spatial_entries = new std::unordered_map<detail::RenderTaskInternal*, SpatialIndexEntry>();
+            self->spatial_oversized = new std::vector<detail::RenderTaskInternal*>();
+            self->shape_to_tasks = new std::unordered_multimap<detail::ShapeInternal*, detail::RenderTaskInternal*>();
+            self->spatial_moved = new std::unordered_set<detail::ShapeInternal*>();
+
+            self->sorting_enabled = false;
+            self->sorted_layers = new std::map<int32_t, std::list<RenderQueueSegment>>();
+            self->sort_outdated = new std::unordered_set<detail::ShapeInternal*>();
+            self->sort_program_version = SHADER_PROGRAM_VERSION;
+            self->draw_order = new std::vector<detail::RenderTaskInternal*>();
+
             self->apply_msaa = msaa_samples > 0;
 
+            self->batching_enabled = true;
+            self->n_batches = 0;
+            self->batch_vertex_array_id = 0;
+            self->batch_vertex_buffer_id = 0;
+            self->batch_element_buffer_id = 0;
+            self->batch_vertices = new std::vector<detail::VertexInfo>();
+            self->batch_indices = new std::vector<GLuint>();
+
+            self->statistics_enabled = false;
+            self->gpu_timing_enabled = true;
+            self->frame_index = 0;
+            self->statistics = new FrameStatistics();
+            self->current_statistics = nullptr;
+            self->pending_statistics = new std::deque<PendingFrameStatistics>();
+            self->timestamp_query_pool = new std::vector<GLNativeHandle>();
+
+            self->render_on_demand_enabled = false;
+            self->frame_cache_valid = false;
+            self->frame_cache_version = 0;
+            self->frame_cache = nullptr;
+
+            self->render_texture_shape = nullptr;
+            self->render_texture_shape_task = nullptr;
+            self->render_texture_shader = nullptr;
+
+            // internal render targets are never sampled by the user, so they may use storage larger than the area, which makes resizing cheap
             if (self->apply_msaa)
             {
                 self->render_texture = new MultisampledRenderTexture(msaa_samples);
+                ((MultisampledRenderTextureInternal*) self->render_texture->get_internal())->bucketed = true;
+            }
+            else
+                self->render_texture = nullptr;
 
-                self->render_texture_shape = new Shape();
-                self->render_texture_shape->as_rectangle({-1, 1}, {2, 2});
-                self->render_texture_shape->set_texture(self->render_texture);
+            return self;
+        }
 
-                static const std::string RENDER_TEXTURE_SHADER_SOURCE = R"(
-                    #version 130
+        bool RenderQueueSortKey::operator<(const RenderQueueSortKey& other) const
+        {
+            if (program_id != other.program_id)
+                return program_id < other.program_id;
 
-                    in vec4 _vertex_color;
-                    in vec2 _texture_coordinates;
-                    in vec3 _vertex_position;
+            if (texture != other.texture)
+                return std::less<const void*>()(texture, other.texture);
 
-                    out vec4 _fragment_color;
+            if (blend_mode != other.blend_mode)
+                return blend_mode < other.blend_mode;
 
-                    uniform int _texture_set;
-                    uniform sampler2D _texture;
+            return sequence < other.sequence;
+        }
 
-                    void main()
-                    {
-                        // flip horizontally to correct render texture inversion
-                        _fragment_color = texture2D(_texture, vec2(_texture_coordinates.x, 1 - _texture_coordinates.y)) * _vertex_color;
-                    }
-                )";
+        // whether the result of drawing several tasks with this blend mode does not depend on their order
+        static bool render_area_internal_is_commutative(int32_t blend_mode)
+        {
+            return blend_mode == BlendMode::ADD or blend_mode == BlendMode::SUBTRACT or blend_mode == BlendMode::MULTIPLY or blend_mode == BlendMode::MIN or blend_mode == BlendMode::MAX;
+        }
+
+        // key tasks are sorted by within a segment, uses the program that will actually be bound, which is the fallback while the shader is compiling
+        static RenderQueueSortKey render_area_internal_get_sort_key(const RenderQueueEntry& entry)
+        {
+            return RenderQueueSortKey{
+                render_task_internal_get_shader(entry.task)->program_id,
+                entry.task->_shape->texture,
+                (int32_t) entry.task->_blend_mode,
+                entry.sequence,
+                entry.task
+            };
+        }
 
-                self->render_texture_shader = new Shader();
-                self->render_texture_shader->create_from_string(ShaderType::FRAGMENT, RENDER_TEXTURE_SHADER_SOURCE);
+        // whether a task may be drawn in any order relative to all tasks already in the segment
+        static bool render_area_internal_commutes(const RenderQueueSegment& segment, bool is_bounded, Vector2f min, Vector2f max, int32_t blend_mode)
+        {
+            bool is_disjoint = is_bounded and segment.is_bounded and (max.x < segment.min.x or min.x > segment.max.x or max.y < segment.min.y or min.y > segment.max.y);
+            bool blends_commutatively = segment.has_common_blend_mode and segment.blend_mode == blend_mode and render_area_internal_is_commutative(blend_mode);
+            return is_disjoint or blends_commutatively;
+        }
 
-                self->render_texture_shape_task = new RenderTask(*self->render_texture_shape, self->render_texture_shader);
+        static void render_area_internal_segment_join(RenderQueueSegment& segment, bool is_bounded, Vector2f min, Vector2f max, int32_t blend_mode)
+        {
+            if (segment.tasks.empty())
+            {
+                segment.is_bounded = is_bounded;
+                segment.min = min;
+                segment.max = max;
+                segment.has_common_blend_mode = true;
+                segment.blend_mode = blend_mode;
             }
             else
             {
-                self->render_texture = nullptr;
-                self->render_texture_shape = nullptr;
-                self->render_texture_shape_task = nullptr;
+                segment.is_bounded = segment.is_bounded and is_bounded;
+                segment.min = glm::min(segment.min, min);
+                segment.max = glm::max(segment.max, max);
+                segment.has_common_blend_mode = segment.has_common_blend_mode and segment.blend_mode == blend_mode;
             }
-
-            return self;
         }
-    }
 
-    RenderArea::RenderArea(AntiAliasingQuality msaa_samples)
-        : Widget(gtk_gl_area_new()),
-          CTOR_SIGNAL(RenderArea, render),
-          CTOR_SIGNAL(RenderArea, resize),
-          CTOR_SIGNAL(RenderArea, realize),
-          CTOR_SIGNAL(RenderArea, unrealize),
-          CTOR_SIGNAL(RenderArea, destroy),
-          CTOR_SIGNAL(RenderArea, hide),
-          CTOR_SIGNAL(RenderArea, show),
-          CTOR_SIGNAL(RenderArea, map),
-          CTOR_SIGNAL(RenderArea, unmap)
-    {
-        if (detail::is_opengl_disabled())
+        // recompute bounds and blend mode of a segment from the tasks it contains
+        static void render_area_internal_segment_update(RenderQueueSegment& segment)
         {
-            log::critical("In RenderArea(): trying to instantiate RenderArea, but the OpenGL component is disabled.", MOUSETRAP_DOMAIN);
-            _internal = nullptr;
-            return;
+            auto tasks = std::move(segment.tasks);
+            segment.tasks.clear();
+
+            for (auto& key : tasks)
+            {
+                auto min = Vector2f(0, 0);
+                auto max = Vector2f(0, 0);
+                bool is_bounded = render_task_internal_get_bounds(key.task, min, max);
+                render_area_internal_segment_join(segment, is_bounded, min, max, key.blend_mode);
+                segment.tasks.insert(segment.tasks.end(), key);
+            }
         }
 
-        _internal = detail::render_area_internal_new(GTK_GL_AREA(operator NativeWidget()), (int) msaa_samples);
-        detail::attach_ref_to(G_OBJECT(_internal->native), _internal);
+        // add entry to the end of its layer, joining the last segment if it commutes with all tasks in it
+        static void render_area_internal_sort_entry(RenderAreaInternal* self, RenderQueueEntry& entry)
+        {
+            auto& segments = (*self->sorted_layers)[entry.layer];
 
-        gtk_gl_area_set_auto_render(GTK_GL_AREA(operator NativeWidget()), TRUE);
-        gtk_widget_set_size_request(GTK_WIDGET(GTK_GL_AREA(operator NativeWidget())), 1, 1);
+            entry.key = render_area_internal_get_sort_key(entry);
+            entry.geometry_version = entry.task->_shape->geometry_version;
 
-        g_signal_connect(_internal->native, "realize", G_CALLBACK(on_realize), _internal);
-        g_signal_connect(_internal->native, "resize", G_CALLBACK(on_resize), _internal);
-        g_signal_connect(_internal->native, "render", G_CALLBACK(on_render), _internal);
-        g_signal_connect(_internal->native, "create-context", G_CALLBACK(on_create_context), _internal);
-    }
+            auto min = Vector2f(0, 0);
+            auto max = Vector2f(0, 0);
+            bool is_bounded = render_task_internal_get_bounds(entry.task, min, max);
+            auto blend_mode = entry.key.blend_mode;
 
-    RenderArea::~RenderArea()
-    {}
+            if (segments.empty() or not render_area_internal_commutes(segments.back(), is_bounded, min, max, blend_mode))
+                segments.emplace_back();
 
-    RenderArea::RenderArea(detail::RenderAreaInternal* internal)
-        : Widget(internal == nullptr ? gtk_gl_area_new() : GTK_WIDGET(internal->native)),
-          CTOR_SIGNAL(RenderArea, render),
-          CTOR_SIGNAL(RenderArea, resize),
-          CTOR_SIGNAL(RenderArea, realize),
-          CTOR_SIGNAL(RenderArea, unrealize),
-          CTOR_SIGNAL(RenderArea, destroy),
-          CTOR_SIGNAL(RenderArea, hide),
-          CTOR_SIGNAL(RenderArea, show),
-          CTOR_SIGNAL(RenderArea, map),
-          CTOR_SIGNAL(RenderArea, unmap)
-    {
-        if (detail::is_opengl_disabled())
+            entry.segment = std::prev(segments.end());
+            render_area_internal_segment_join(*entry.segment, is_bounded, min, max, blend_mode);
+            entry.segment->tasks.insert(entry.key);
+        }
+
+        static void render_area_internal_unsort_entry(RenderAreaInternal* self, RenderQueueEntry& entry)
         {
-            _internal = nullptr;
-            return;
+            auto layer_it = self->sorted_layers->find(entry.layer);
+            if (layer_it == self->sorted_layers->end())
+                return;
+
+            // segment bounds are not shrunk, which is conservative but still correct
+            entry.segment->tasks.erase(entry.key);
+            if (entry.segment->tasks.empty())
+                layer_it->second.erase(entry.segment);
+
+            if (layer_it->second.empty())
+                self->sorted_layers->erase(layer_it);
         }
 
-        _internal = g_object_ref(internal);
+        // update the key of an entry whose shape moved or whose program or texture changed. Only the entries own segment is modified:
+        // if the entry no longer commutes with the rest of it, the segment is split such that the entry is drawn after all tasks queued before it, and before all tasks queued after it
+        static void render_area_internal_resort_entry(RenderAreaInternal* self, RenderQueueEntry& entry)
+        {
+            auto key = render_area_internal_get_sort_key(entry);
+            bool key_changed = key.program_id != entry.key.program_id or key.texture != entry.key.texture;
+            bool moved = entry.geometry_version != entry.task->_shape->geometry_version;
 
-        gtk_gl_area_set_auto_render(GTK_GL_AREA(operator NativeWidget()), TRUE);
-        gtk_widget_set_size_request(GTK_WIDGET(GTK_GL_AREA(operator NativeWidget())), 1, 1);
+            if (not key_changed and not moved)
+                return;
 
-        g_signal_connect(_internal->native, "realize", G_CALLBACK(on_realize), _internal);
-        g_signal_connect(_internal->native, "resize", G_CALLBACK(on_resize), _internal);
-        g_signal_connect(_internal->native, "render", G_CALLBACK(on_render), _internal);
-        g_signal_connect(_internal->native, "create-context", G_CALLBACK(on_create_context), _internal);
-    }
+            auto& segments = self->sorted_layers->at(entry.layer);
+            auto segment = entry.segment;
 
-    void RenderArea::add_render_task(RenderTask task)
-    {
-        if (detail::is_opengl_disabled())
-            return;
+            segment->tasks.erase(entry.key);
+            entry.key = key;
 
-        auto* task_internal = (detail::RenderTaskInternal*) task.operator GObject*();
-        _internal->tasks->push_back(task_internal);
-        g_object_ref(task_internal);
-    }
+            // which tasks may be reordered depends only on bounds and blend mode, so the segment stays valid
+            if (not moved)
+            {
+                segment->tasks.insert(entry.key);
+                return;
+            }
 
-    void RenderArea::clear_render_tasks()
-    {
-        if (detail::is_opengl_disabled())
-            return;
+            entry.geometry_version = entry.task->_shape->geometry_version;
 
-        for (auto& task : *_internal->tasks)
-            g_object_unref(task);
+            auto min = Vector2f(0, 0);
+            auto max = Vector2f(0, 0);
+            bool is_bounded = render_task_internal_get_bounds(entry.task, min, max);
 
-        _internal->tasks->clear();
-    }
+            render_area_internal_segment_update(*segment);
 
-    void RenderArea::flush()
-    {
-        if (detail::is_opengl_disabled())
-            return;
+            if (segment->tasks.empty() or render_area_internal_commutes(*segment, is_bounded, min, max, key.blend_mode))
+            {
+                render_area_internal_segment_join(*segment, is_bounded, min, max, key.blend_mode);
+                segment->tasks.insert(entry.key);
+                return;
+            }
 
-        glFlush();
-    }
+            auto after = segments.insert(std::next(segment), RenderQueueSegment());
+            auto own = segments.insert(after, RenderQueueSegment());
 
-    void RenderArea::clear()
-    {
-        if (detail::is_opengl_disabled())
-            return;
+            auto it = segment->tasks.begin();
+            while (it != segment->tasks.end())
+            {
+                if (it->sequence < entry.sequence)
+                {
+                    it++;
+                    continue;
+                }
 
-        glClear(GL_COLOR_BUFFER_BIT);
-        glClearColor(0, 0, 0, 0);
-    }
+                after->tasks.insert(*it);
+                self->tasks->at({entry.layer, it->sequence}).segment = after;
+                it = segment->tasks.erase(it);
+            }
 
-    GdkGLContext* RenderArea::on_create_context(GtkGLArea* area, GdkGLContext* context, detail::RenderAreaInternal* internal)
-    {
-        if (detail::is_opengl_disabled())
-            return nullptr;
+            render_area_internal_segment_join(*own, is_bounded, min, max, key.blend_mode);
+            own->tasks.insert(entry.key);
+            entry.segment = own;
 
-        detail::initialize_opengl();
-        g_object_ref(detail::GL_CONTEXT);
-        gdk_gl_context_make_current(detail::GL_CONTEXT);
-        return detail::GL_CONTEXT;
-    }
+            if (segment->tasks.empty())
+                segments.erase(segment);
+            else
+                render_area_internal_segment_update(*segment);
 
-    void RenderArea::on_realize(GtkWidget* area, detail::RenderAreaInternal* internal)
-    {
-        if (detail::is_opengl_disabled())
-            return;
+            if (after->tasks.empty())
+                segments.erase(after);
+            else
+                render_area_internal_segment_update(*after);
+        }
 
-        gtk_gl_area_queue_render(GTK_GL_AREA(area));
-    }
+        static void render_area_internal_resort_shape(RenderAreaInternal* self, ShapeInternal* shape)
+        {
+            auto range = self->shape_to_tasks->equal_range(shape);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                auto keys = self->task_to_key->equal_range(it->second);
+                for (auto key_it = keys.first; key_it != keys.second; ++key_it)
+                {
+                    auto entry_it = self->tasks->find(key_it->second);
+                    if (entry_it != self->tasks->end())
+                        render_area_internal_resort_entry(self, entry_it->second);
+                }
+            }
+        }
 
-    void RenderArea::on_resize(GtkGLArea* area, gint width, gint height, detail::RenderAreaInternal* internal)
-    {
-        if (detail::is_opengl_disabled())
-            return;
+        // write tasks into self->draw_order, in the order they should be drawn in
+        static void render_area_internal_update_draw_order(RenderAreaInternal* self)
+        {
+            auto& draw_order = *self->draw_order;
+            draw_order.clear();
 
-        assert(GDK_IS_GL_CONTEXT(detail::GL_CONTEXT));
+            if (not self->sorting_enabled)
+            {
+                for (auto& pair : *self->tasks)
+                    draw_order.push_back(pair.second.task);
 
-        if (internal->apply_msaa)
-            internal->render_texture->create(width, height);
+                return;
+            }
 
-        gtk_gl_area_make_current(area);
-        gtk_gl_area_queue_render(area);
-    }
+            // programs change rarely, after a shader finished linking or was recreated, only then are all keys checked
+            if (self->sort_program_version != SHADER_PROGRAM_VERSION)
+            {
+                for (auto& pair : *self->tasks)
+                    render_area_internal_resort_entry(self, pair.second);
 
-    gboolean RenderArea::on_render(GtkGLArea* area, GdkGLContext* context, detail::RenderAreaInternal* internal)
-    {
-        if (detail::is_opengl_disabled())
-            return FALSE;
+                self->sort_program_version = SHADER_PROGRAM_VERSION;
+            }
 
-        assert(GDK_IS_GL_CONTEXT(detail::GL_CONTEXT));
-        gtk_gl_area_make_current(area);
+            // otherwise, only tasks whose shape moved or changed its texture are visited
+            for (auto* shape : *self->sort_outdated)
+                render_area_internal_resort_shape(self, shape);
 
-        if (internal->apply_msaa)
+            self->sort_outdated->clear();
+
+            for (auto& layer : *self->sorted_layers)
+                for (auto& segment : layer.second)
+                    for (auto& key : segment.tasks)
+                        draw_order.push_back(key.task);
+        }
+
+        // side length of one cell of the spatial index, in gl coordinates, the visible area is covered by 32x32 cells
+        static constexpr float SPATIAL_INDEX_CELL_SIZE = 2.f / 32;
+
+        // tasks covering more cells than this are tested individually instead of being inserted into every cell
+        static constexpr uint64_t SPATIAL_INDEX_MAX_N_CELLS = 256;
+
+        static int32_t render_area_internal_spatial_cell(float gl_coordinate)
         {
-            internal->render_texture->bind_as_render_target();
+            // clamp so positions far outside the visible area do not overflow
+            static constexpr float limit = 1 << 30;
+            return (int32_t) std::floor(std::clamp(gl_coordinate / SPATIAL_INDEX_CELL_SIZE, -limit, limit));
+        }
 
-            RenderArea::clear();
-            glEnable(GL_BLEND);
-            set_current_blend_mode(BlendMode::NORMAL);
+        static uint64_t render_area_internal_spatial_key(int32_t x, int32_t y)
+        {
+            return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y));
+        }
 
-            for (auto* internal:*(internal->tasks))
-                RenderTask(internal).render();
+        static void render_area_internal_spatial_insert(RenderAreaInternal* self, RenderTaskInternal* task)
+        {
+            auto& entry = (*self->spatial_entries)[task];
+            entry.geometry_version = task->_shape->geometry_version;
+            entry.is_bounded = render_task_internal_get_bounds(task, entry.min, entry.max);
+            entry.is_oversized = false;
 
-            RenderArea::flush();
+            if (not entry.is_bounded)
+                return;
 
-            internal->render_texture->unbind_as_render_target();
+            entry.cell_min = {render_area_internal_spatial_cell(entry.min.x), render_area_internal_spatial_cell(entry.min.y)};
+            entry.cell_max = {render_area_internal_spatial_cell(entry.max.x), render_area_internal_spatial_cell(entry.max.y)};
 
-            RenderArea::clear();
-            glEnable(GL_BLEND);
-            set_current_blend_mode(BlendMode::NORMAL);
+            auto n_cells = uint64_t(int64_t(entry.cell_max.x) - entry.cell_min.x + 1) * uint64_t(int64_t(entry.cell_max.y) - entry.cell_min.y + 1);
+            if (n_cells > SPATIAL_INDEX_MAX_N_CELLS)
+            {
+                entry.is_oversized = true;
+                self->spatial_oversized->push_back(task);
+                return;
+            }
 
-            internal->render_texture_shape_task->render();
-            RenderArea::flush();
+            for (int32_t x = entry.cell_min.x; x <= entry.cell_max.x; ++x)
+                for (int32_t y = entry.cell_min.y; y <= entry.cell_max.y; ++y)
+                    (*self->spatial_cells)[render_area_internal_spatial_key(x, y)].push_back(task);
         }
-        else
+
+        static void render_area_internal_spatial_remove(RenderAreaInternal* self, RenderTaskInternal* task)
         {
-            RenderArea::clear();
+            auto it = self->spatial_entries->find(task);
+            if (it == self->spatial_entries->end())
+                return;
 
-            glEnable(GL_BLEND);
-            set_current_blend_mode(BlendMode::NORMAL);
+            auto& entry = it->second;
 
-            for (auto* internal:*(internal->tasks))
-                RenderTask(internal).render();
+            auto erase_from = [&](std::vector<RenderTaskInternal*>& tasks){
+                auto task_it = std::find(tasks.begin(), tasks.end(), task);
+                if (task_it != tasks.end())
+                {
+                    *task_it = tasks.back();
+                    tasks.pop_back();
+                }
+            };
 
-            RenderArea::flush();
+            if (entry.is_oversized)
+                erase_from(*self->spatial_oversized);
+            else if (entry.is_bounded)
+            {
+                for (int32_t x = entry.cell_min.x; x <= entry.cell_max.x; ++x)
+                {
+                    for (int32_t y = entry.cell_min.y; y <= entry.cell_max.y; ++y)
+                    {
+                        auto cell_it = self->spatial_cells->find(render_area_internal_spatial_key(x, y));
+                        if (cell_it == self->spatial_cells->end())
+                            continue;
+
+                        erase_from(cell_it->second);
+                        if (cell_it->second.empty())
+                            self->spatial_cells->erase(cell_it);
+                    }
+                }
+            }
+
+            self->spatial_entries->erase(it);
         }
 
-        return TRUE;
-    }
+        // re-insert the tasks of all shapes that moved since they were indexed, tasks of shapes that did not move are not visited
+        static void render_area_internal_spatial_refresh(RenderAreaInternal* self)
+        {
+            if (self->spatial_moved->empty())
+                return;
 
-    void RenderArea::render_render_tasks()
-    {
-        if (detail::is_opengl_disabled())
-            return;
+            std::vector<RenderTaskInternal*> moved;
+            for (auto* shape : *self->spatial_moved)
+            {
+                auto range = self->shape_to_tasks->equal_range(shape);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    auto entry_it = self->spatial_entries->find(it->second);
+                    if (entry_it != self->spatial_entries->end() and entry_it->second.geometry_version != shape->geometry_version)
+                        moved.push_back(it->second);
+                }
+            }
+
+            for (auto* task : moved)
+            {
+                render_area_internal_spatial_remove(self, task);
+                render_area_internal_spatial_insert(self, task);
+            }
+
+            self->spatial_moved->clear();
+        }
 
-        for (auto* internal : *(_internal->tasks))
+        // register the area with the shape of a newly added task, such that the area is notified when the shape moves
+        static void render_area_internal_track_shape(RenderAreaInternal* self, RenderTaskInternal* task)
         {
-            auto task = RenderTask(internal);
-            task.render();
+            self->shape_to_tasks->insert({task->_shape, task});
+            (*task->_shape->indexing_areas)[self] += 1;
         }
+
+        static void render_area_internal_untrack_shape(RenderAreaInternal* self, RenderTaskInternal* task)
+        {
+            auto* shape = task->_shape;
+            auto range = self->shape_to_tasks->equal_range(shape);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second == task)
+                {
+                    self->shape_to_tasks->erase(it);
+                    break;
+                }
+            }
+
+            auto area_it = shape->indexing_areas->find(self);
+            if (area_it != shape->indexing_areas->end() and --area_it->second == 0)
+            {
+                shape->indexing_areas->erase(area_it);
+                self->spatial_moved->erase(shape);
+                self->sort_outdated->erase(shape);
+            }
+        }
+
+        static void render_area_internal_untrack_all_shapes(RenderAreaInternal* self)
+        {
+            for (auto& pair : *self->shape_to_tasks)
+                pair.first->indexing_areas->erase(self);
+
+            self->shape_to_tasks->clear();
+            self->spatial_moved->clear();
+            self->sort_outdated->clear();
+        }
+
+        void render_area_internal_shape_moved(RenderAreaInternal* self, ShapeInternal* shape)
+        {
+            self->spatial_moved->insert(shape);
+            if (self->sorting_enabled)
+                self->sort_outdated->insert(shape);
+        }
+
+        void render_area_internal_shape_texture_changed(RenderAreaInternal* self, ShapeInternal* shape)
+        {
+            if (self->sorting_enabled)
+                self->sort_outdated->insert(shape);
+        }
+
+        // sort query results by draw order
+        static std::vector<RenderTask> render_area_internal_spatial_collect(RenderAreaInternal* self, std::vector<RenderTaskInternal*>& found)
+        {
+            std::vector<std::pair<std::pair<int32_t, uint64_t>, RenderTaskInternal*>> sorted;
+            sorted.reserve(found.size());
+
+            for (auto* task : found)
+            {
+                auto range = self->task_to_key->equal_range(task);
+                auto key = range.first->second;
+                for (auto it = range.first; it != range.second; ++it)
+                    key = std::max(key, it->second);
+
+                sorted.push_back({key, task});
+            }
+
+            std::sort(sorted.begin(), sorted.end());
+
+            std::vector<RenderTask> out;
+            out.reserve(sorted.size());
+            for (auto& pair : sorted)
+                out.emplace_back(pair.second);
+
+            return out;
+        }
+
+        // whether the task lies entirely outside of the [-1, 1] gl coordinate range and would not produce any fragments
+        static bool render_area_internal_is_outside_viewport(RenderTaskInternal* task)
+        {
+            // point sprites may extend past their vertex by an amount only known to the shader
+            if (task->_shape->render_type == GL_POINTS)
+                return false;
+
+            Vector2f min, max;
+            if (not render_task_internal_get_bounds(task, min, max))
+                return false;
+
+            return max.x < -1 or min.x > 1 or max.y < -1 or min.y > 1;
+        }
+
+        static bool render_area_internal_is_batchable(RenderTaskInternal* task)
+        {
+            auto* shape = task->_shape;
+            return shape->instance_buffer == nullptr and shape_internal_get_n_vertices(shape) > 0 and not shape->indices->empty();
+        }
+
+        // primitive type a shape is drawn as when merged into a batch, strips, fans and loops are unrolled
+        static GLenum render_area_internal_get_batch_primitive(GLenum render_type)
+        {
+            if (render_type == GL_POINTS)
+                return GL_POINTS;
+            else if (render_type == GL_LINES or render_type == GL_LINE_STRIP or render_type == GL_LINE_LOOP)
+                return GL_LINES;
+            else
+                return GL_TRIANGLES;
+        }
+
+        static void render_area_internal_append_to_batch(RenderAreaInternal* self, ShapeInternal* shape)
+        {
+            auto offset = (GLuint) self->batch_vertices->size();
+            shape_internal_append_vertex_data(shape, *self->batch_vertices);
+
+            const auto& in = *shape->indices;
+            auto& out = *self->batch_indices;
+            uint64_t n = in.size();
+
+            auto push = [&](uint64_t i) {
+                out.push_back(offset + in[i]);
+            };
+
+            if (shape->render_type == GL_TRIANGLE_STRIP)
+            {
+                for (uint64_t i = 2; i < n; ++i)
+                {
+                    // keep winding order consistent
+                    if (i % 2 == 0)
+                    {
+                        push(i - 2);
+                        push(i - 1);
+                    }
+                    else
+                    {
+                        push(i - 1);
+                        push(i - 2);
+                    }
+                    push(i);
+                }
+            }
+            else if (shape->render_type == GL_TRIANGLE_FAN)
+            {
+                for (uint64_t i = 2; i < n; ++i)
+                {
+                    push(0);
+                    push(i - 1);
+                    push(i);
+                }
+            }
+            else if (shape->render_type == GL_LINE_STRIP or shape->render_type == GL_LINE_LOOP)
+            {
+                for (uint64_t i = 1; i < n; ++i)
+                {
+                    push(i - 1);
+                    push(i);
+                }
+
+                if (shape->render_type == GL_LINE_LOOP and n > 1)
+                {
+                    push(n - 1);
+                    push(0);
+                }
+            }
+            else
+            {
+                for (uint64_t i = 0; i < n; ++i)
+                    push(i);
+            }
+        }
+
+        static void render_area_internal_render_batch(RenderAreaInternal* self, const std::vector<RenderTaskInternal*>& batch, GLenum primitive)
+        {
+            if (batch.empty())
+                return;
+
+            self->n_batches += 1;
+
+            if (batch.size() == 1)
+            {
+                // not through RenderTask::render, shaders were already advanced this frame
+                auto* task = batch.front();
+                render_task_internal_apply_state(task);
+                Shape(task->_shape).render(Shader(render_task_internal_get_shader(task)), task->_transform);
+                return;
+            }
+
+            if (self->batch_vertex_array_id == 0)
+            {
+                glGenVertexArrays(1, &self->batch_vertex_array_id);
+                glGenBuffers(1, &self->batch_vertex_buffer_id);
+                glGenBuffers(1, &self->batch_element_buffer_id);
+
+                gl_state_bind_vertex_array(self->batch_vertex_array_id);
+                glBindBuffer(GL_ARRAY_BUFFER, self->batch_vertex_buffer_id);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->batch_element_buffer_id);
+
+                auto position_location = Shader::get_vertex_position_location();
+                glEnableVertexAttribArray(position_location);
+                glVertexAttribPointer(position_location, 3, GL_FLOAT, GL_FALSE, sizeof(struct detail::VertexInfo), (GLvoid*) (G_STRUCT_OFFSET(struct detail::VertexInfo, _position)));
+
+                auto color_location = Shader::get_vertex_color_location();
+                glEnableVertexAttribArray(color_location);
+                glVertexAttribPointer(color_location, 4, GL_FLOAT, GL_FALSE, sizeof(struct detail::VertexInfo), (GLvoid*) (G_STRUCT_OFFSET(struct detail::VertexInfo, _color)));
+
+                auto texture_coordinate_location = Shader::get_vertex_texture_coordinate_location();
+                glEnableVertexAttribArray(texture_coordinate_location);
+                glVertexAttribPointer(texture_coordinate_location, 2, GL_FLOAT, GL_FALSE, sizeof(struct detail::VertexInfo), (GLvoid*) (G_STRUCT_OFFSET(struct detail::VertexInfo, _texture_coordinates)));
+
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+
+            self->batch_vertices->clear();
+            self->batch_indices->clear();
+
+            for (auto* task : batch)
+                render_area_internal_append_to_batch(self, task->_shape);
+
+            auto* first = batch.front();
+            auto* texture = first->_shape->texture;
+
+            render_task_internal_apply_state(first);
+
+            auto* shader = render_task_internal_get_shader(first);
+            auto* uniforms = shader_internal_get_uniform_cache(shader, shader->program_id);
+            glUniformMatrix4fv(uniforms->transform_location, 1, GL_FALSE, &(first->_transform.transform[0][0]));
+            glUniform1i(uniforms->texture_set_location, texture != nullptr ? GL_TRUE : GL_FALSE);
+
+            if (texture != nullptr)
+                texture->bind();
+
+            gl_state_bind_vertex_array(self->batch_vertex_array_id);
+
+            // re-specifying the whole store orphans the previous one, so the driver does not have to wait for pending draws
+            glBindBuffer(GL_ARRAY_BUFFER, self->batch_vertex_buffer_id);
+            glBufferData(GL_ARRAY_BUFFER, self->batch_vertices->size() * sizeof(struct detail::VertexInfo), self->batch_vertices->data(), GL_STREAM_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, self->batch_indices->size() * sizeof(GLuint), self->batch_indices->data(), GL_STREAM_DRAW);
+
+            glDrawElements(primitive, self->batch_indices->size(), GL_UNSIGNED_INT, nullptr);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            gl_statistics_count_upload(self->batch_vertices->size() * sizeof(struct detail::VertexInfo) + self->batch_indices->size() * sizeof(GLuint));
+            gl_statistics_count_draw(self->batch_indices->size());
+        }
+
+        static void render_area_internal_record_timestamp(RenderAreaInternal* self)
+        {
+            GLNativeHandle query = 0;
+            if (self->timestamp_query_pool->empty())
+                glGenQueries(1, &query);
+            else
+            {
+                query = self->timestamp_query_pool->back();
+                self->timestamp_query_pool->pop_back();
+            }
+
+            glQueryCounter(query, GL_TIMESTAMP);
+            self->current_statistics->timestamps.push_back(query);
+        }
+
+        // read back timer queries of earlier frames, only once the GPU is done with them, so this never stalls
+        static void render_area_internal_collect_statistics(RenderAreaInternal* self)
+        {
+            static constexpr uint64_t max_n_pending = 4;
+
+            auto& pending = *self->pending_statistics;
+            while (not pending.empty())
+            {
+                auto& front = pending.front();
+
+                GLint available = GL_FALSE;
+                glGetQueryObjectiv(front.timestamps.back(), GL_QUERY_RESULT_AVAILABLE, &available);
+
+                // if the GPU falls too far behind, give up on the oldest frame instead of waiting
+                if (available != GL_TRUE and pending.size() <= max_n_pending)
+                    break;
+
+                if (available == GL_TRUE)
+                {
+                    auto times = std::vector<GLuint64>(front.timestamps.size());
+                    for (uint64_t i = 0; i < times.size(); ++i)
+                        glGetQueryObjectui64v(front.timestamps.at(i), GL_QUERY_RESULT, &times.at(i));
+
+                    auto to_ms = [](GLuint64 begin, GLuint64 end) -> double {
+                        return (end - begin) / 1e6;
+                    };
+
+                    front.statistics.gpu_ms = to_ms(times.front(), times.back());
+                    for (uint64_t i = 0; i < front.statistics.tasks.size(); ++i)
+                        front.statistics.tasks.at(i).gpu_ms = to_ms(times.at(2 * i + 1), times.at(2 * i + 2));
+                }
+
+                self->timestamp_query_pool->insert(self->timestamp_query_pool->end(), front.timestamps.begin(), front.timestamps.end());
+                *self->statistics = std::move(front.statistics);
+                pending.pop_front();
+            }
+        }
+
+        static void render_area_internal_begin_frame_statistics(RenderAreaInternal* self)
+        {
+            if (not self->statistics_enabled)
+                return;
+
+            render_area_internal_collect_statistics(self);
+
+            delete self->current_statistics;
+            self->current_statistics = new PendingFrameStatistics();
+            self->current_statistics->statistics.frame_index = self->frame_index++;
+            self->current_statistics->counters_start = gl_statistics_get();
+            self->current_statistics->cpu_start = std::chrono::steady_clock::now();
+
+            if (self->gpu_timing_enabled)
+                render_area_internal_record_timestamp(self);
+        }
+
+        static void render_area_internal_end_frame_statistics(RenderAreaInternal* self)
+        {
+            auto* current = self->current_statistics;
+            if (current == nullptr)
+                return;
+
+            auto& statistics = current->statistics;
+            auto counters = gl_statistics_get();
+            statistics.n_draw_calls = counters.n_draw_calls - current->counters_start.n_draw_calls;
+            statistics.n_vertices = counters.n_vertices - current->counters_start.n_vertices;
+            statistics.n_bytes_uploaded = counters.n_bytes_uploaded - current->counters_start.n_bytes_uploaded;
+            statistics.cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - current->cpu_start).count();
+
+            if (current->timestamps.empty())
+                *self->statistics = std::move(statistics);
+            else
+            {
+                render_area_internal_record_timestamp(self);
+                self->pending_statistics->push_back(std::move(*current));
+            }
+
+            delete current;
+            self->current_statistics = nullptr;
+        }
+
+        static FrameStatisticsScope render_area_internal_begin_draw_statistics(RenderAreaInternal* self)
+        {
+            auto out = FrameStatisticsScope();
+            if (self->current_statistics == nullptr)
+                return out;
+
+            if (not self->current_statistics->timestamps.empty())
+                render_area_internal_record_timestamp(self);
+
+            out.counters_start = gl_statistics_get();
+            out.cpu_start = std::chrono::steady_clock::now();
+            return out;
+        }
+
+        static void render_area_internal_end_draw_statistics(RenderAreaInternal* self, const FrameStatisticsScope& scope, const std::vector<RenderTaskInternal*>& tasks)
+        {
+            if (self->current_statistics == nullptr)
+                return;
+
+            auto statistics = RenderTaskStatistics();
+            statistics.cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scope.cpu_start).count();
+
+            auto counters = gl_statistics_get();
+            statistics.n_draw_calls = counters.n_draw_calls - scope.counters_start.n_draw_calls;
+            statistics.n_vertices = counters.n_vertices - scope.counters_start.n_vertices;
+            statistics.n_bytes_uploaded = counters.n_bytes_uploaded - scope.counters_start.n_bytes_uploaded;
+
+            statistics.tasks.reserve(tasks.size());
+            for (auto* task : tasks)
+                statistics.tasks.emplace_back(task);
+
+            if (not self->current_statistics->timestamps.empty())
+                render_area_internal_record_timestamp(self);
+
+            self->current_statistics->statistics.tasks.push_back(std::move(statistics));
+        }
+
+        static void render_area_internal_render_measured_batch(RenderAreaInternal* self, const std::vector<RenderTaskInternal*>& batch, GLenum primitive)
+        {
+            if (batch.empty())
+                return;
+
+            auto scope = render_area_internal_begin_draw_statistics(self);
+            render_area_internal_render_batch(self, batch, primitive);
+            render_area_internal_end_draw_statistics(self, scope, batch);
+        }
+
+        // latest version of all tasks and their inputs, only changes if one of them was modified since the last frame
+        static uint64_t render_area_internal_get_version(RenderAreaInternal* self)
+        {
+            uint64_t out = 0;
+            for (auto& pair : *self->tasks)
+                out = std::max(out, render_task_internal_get_version(pair.second.task));
+
+            return out;
+        }
+
+        // advance every shader that is being compiled asynchronously once per frame, no matter how many tasks use it or whether they are visible
+        static bool render_area_internal_advance_shaders(RenderAreaInternal* self)
+        {
+            std::vector<ShaderInternal*> pending;
+            auto add = [&](ShaderInternal* shader) {
+                if (shader != nullptr and shader->compile_stage != ShaderCompileStage::READY and std::find(pending.begin(), pending.end(), shader) == pending.end())
+                    pending.push_back(shader);
+            };
+
+            for (auto& pair : *self->tasks)
+            {
+                add(pair.second.task->_shader);
+                add(pair.second.task->_fallback_shader);
+            }
+
+            bool is_compiling = false;
+            for (auto* shader : pending)
+            {
+                shader_internal_advance(shader);
+                if (shader->compile_stage != ShaderCompileStage::READY)
+                    is_compiling = true;
+            }
+
+            return is_compiling;
+        }
+
+        static void render_area_internal_render_tasks(RenderAreaInternal* self)
+        {
+            self->n_batches = 0;
+            render_area_internal_update_draw_order(self);
+
+            std::vector<RenderTaskInternal*> batch;
+            GLenum batch_primitive = GL_TRIANGLES;
+
+            for (auto* task : *self->draw_order)
+            {
+                if (not task->_shape->is_visible)
+                    continue;
+
+                if (self->culling_enabled and render_area_internal_is_outside_viewport(task))
+                    continue;
+
+                if (not self->batching_enabled or not render_area_internal_is_batchable(task))
+                {
+                    render_area_internal_render_measured_batch(self, batch, batch_primitive);
+                    batch.clear();
+
+                    // not through RenderTask::render, shaders were already advanced this frame
+                    auto scope = render_area_internal_begin_draw_statistics(self);
+                    render_task_internal_apply_state(task);
+                    Shape(task->_shape).render(Shader(render_task_internal_get_shader(task)), task->_transform);
+                    render_area_internal_end_draw_statistics(self, scope, {task});
+
+                    self->n_batches += 1;
+                    continue;
+                }
+
+                auto primitive = render_area_internal_get_batch_primitive(task->_shape->render_type);
+                if (not batch.empty() and (primitive != batch_primitive or not render_task_internal_has_same_state(batch.front(), task)))
+                {
+                    render_area_internal_render_measured_batch(self, batch, batch_primitive);
+                    batch.clear();
+                }
+
+                batch.push_back(task);
+                batch_primitive = primitive;
+            }
+
+            render_area_internal_render_measured_batch(self, batch, batch_primitive);
+        }
+    }
+
+    RenderArea::RenderArea(AntiAliasingQuality msaa_samples)
+        : Widget(gtk_gl_area_new()),
+          CTOR_SIGNAL(RenderArea, render),
+          CTOR_SIGNAL(RenderArea, resize),
+          CTOR_SIGNAL(RenderArea, realize),
+          CTOR_SIGNAL(RenderArea, unrealize),
+          CTOR_SIGNAL(RenderArea, destroy),
+          CTOR_SIGNAL(RenderArea, hide),
+          CTOR_SIGNAL(RenderArea, show),
+          CTOR_SIGNAL(RenderArea, map),
+          CTOR_SIGNAL(RenderArea, unmap)
+    {
+        if (detail::is_opengl_disabled())
+        {
+            log::critical("In RenderArea(): trying to instantiate RenderArea, but the OpenGL component is disabled.", MOUSETRAP_DOMAIN);
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = detail::render_area_internal_new(GTK_GL_AREA(operator NativeWidget()), (int) msaa_samples);
+        detail::attach_ref_to(G_OBJECT(_internal->native), _internal);
+
+        gtk_gl_area_set_auto_render(GTK_GL_AREA(operator NativeWidget()), TRUE);
+        gtk_widget_set_size_request(GTK_WIDGET(GTK_GL_AREA(operator NativeWidget())), 1, 1);
+
+        g_signal_connect(_internal->native, "realize", G_CALLBACK(on_realize), _internal);
+        g_signal_connect(_internal->native, "resize", G_CALLBACK(on_resize), _internal);
+        g_signal_connect(_internal->native, "render", G_CALLBACK(on_render), _internal);
+        g_signal_connect(_internal->native, "create-context", G_CALLBACK(on_create_context), _internal);
+    }
+
+    RenderArea::~RenderArea()
+    {}
+
+    RenderArea::RenderArea(detail::RenderAreaInternal* internal)
+        : Widget(internal == nullptr ? gtk_gl_area_new() : GTK_WIDGET(internal->native)),
+          CTOR_SIGNAL(RenderArea, render),
+          CTOR_SIGNAL(RenderArea, resize),
+          CTOR_SIGNAL(RenderArea, realize),
+          CTOR_SIGNAL(RenderArea, unrealize),
+          CTOR_SIGNAL(RenderArea, destroy),
+          CTOR_SIGNAL(RenderArea, hide),
+          CTOR_SIGNAL(RenderArea, show),
+          CTOR_SIGNAL(RenderArea, map),
+          CTOR_SIGNAL(RenderArea, unmap)
+    {
+        if (detail::is_opengl_disabled())
+        {
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = g_object_ref(internal);
+
+        gtk_gl_area_set_auto_render(GTK_GL_AREA(operator NativeWidget()), TRUE);
+        gtk_widget_set_size_request(GTK_WIDGET(GTK_GL_AREA(operator NativeWidget())), 1, 1);
+
+        g_signal_connect(_internal->native, "realize", G_CALLBACK(on_realize), _internal);
+        g_signal_connect(_internal->native, "resize", G_CALLBACK(on_resize), _internal);
+        g_signal_connect(_internal->native, "render", G_CALLBACK(on_render), _internal);
+        g_signal_connect(_internal->native, "create-context", G_CALLBACK(on_create_context), _internal);
+    }
+
+    void RenderArea::add_render_task(RenderTask task, int32_t layer)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto* task_internal = (detail::RenderTaskInternal*) task.operator GObject*();
+        g_object_ref(task_internal);
+
+        auto sequence = _internal->task_sequence++;
+        auto key = std::make_pair(layer, sequence);
+
+        auto entry = detail::RenderQueueEntry();
+        entry.task = task_internal;
+        entry.layer = layer;
+        entry.sequence = sequence;
+        entry.key = detail::render_area_internal_get_sort_key(entry);
+        entry.geometry_version = task_internal->_shape->geometry_version;
+
+        auto& inserted = _internal->tasks->insert({key, entry}).first->second;
+        _internal->task_to_key->insert({task_internal, key});
+
+        if (_internal->spatial_entries->count(task_internal) == 0)
+        {
+            detail::render_area_internal_spatial_insert(_internal, task_internal);
+            detail::render_area_internal_track_shape(_internal, task_internal);
+        }
+
+        if (_internal->sorting_enabled)
+            detail::render_area_internal_sort_entry(_internal, inserted);
+
+        _internal->frame_cache_valid = false;
+    }
+
+    void RenderArea::remove_render_task(const RenderTask& task)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto* task_internal = (detail::RenderTaskInternal*) task.operator GObject*();
+        auto range = _internal->task_to_key->equal_range(task_internal);
+
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            auto entry_it = _internal->tasks->find(it->second);
+            if (entry_it == _internal->tasks->end())
+                continue;
+
+            if (_internal->sorting_enabled)
+                detail::render_area_internal_unsort_entry(_internal, entry_it->second);
+
+            _internal->tasks->erase(entry_it);
+            g_object_unref(task_internal);
+        }
+
+        if (_internal->spatial_entries->count(task_internal) != 0)
+            detail::render_area_internal_untrack_shape(_internal, task_internal);
+
+        _internal->task_to_key->erase(task_internal);
+        detail::render_area_internal_spatial_remove(_internal, task_internal);
+        _internal->frame_cache_valid = false;
+    }
+
+    void RenderArea::clear_render_tasks()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::render_area_internal_untrack_all_shapes(_internal);
+
+        for (auto& pair : *_internal->tasks)
+            g_object_unref(pair.second.task);
+
+        _internal->tasks->clear();
+        _internal->task_to_key->clear();
+        _internal->sorted_layers->clear();
+
+        _internal->spatial_cells->clear();
+        _internal->spatial_entries->clear();
+        _internal->spatial_oversized->clear();
+        _internal->frame_cache_valid = false;
+    }
+
+    void RenderArea::set_render_task_sorting_enabled(bool b)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        if (b == _internal->sorting_enabled)
+            return;
+
+        _internal->sorting_enabled = b;
+        _internal->sorted_layers->clear();
+        _internal->sort_outdated->clear();
+        _internal->sort_program_version = detail::SHADER_PROGRAM_VERSION;
+        _internal->frame_cache_valid = false;
+
+        if (b)
+            for (auto& pair : *_internal->tasks)
+                detail::render_area_internal_sort_entry(_internal, pair.second);
+    }
+
+    bool RenderArea::get_render_task_sorting_enabled() const
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        return _internal->sorting_enabled;
+    }
+
+    std::vector<RenderTask> RenderArea::query_point(Vector2f position)
+    {
+        if (detail::is_opengl_disabled())
+            return {};
+
+        detail::render_area_internal_spatial_refresh(_internal);
+
+        auto contains = [&](detail::RenderTaskInternal* task) -> bool {
+            const auto& entry = _internal->spatial_entries->at(task);
+            return position.x >= entry.min.x and position.x <= entry.max.x and position.y >= entry.min.y and position.y <= entry.max.y;
+        };
+
+        std::vector<detail::RenderTaskInternal*> found;
+
+        auto cell_x = detail::render_area_internal_spatial_cell(position.x);
+        auto cell_y = detail::render_area_internal_spatial_cell(position.y);
+        auto cell_it = _internal->spatial_cells->find(detail::render_area_internal_spatial_key(cell_x, cell_y));
+        if (cell_it != _internal->spatial_cells->end())
+            for (auto* task : cell_it->second)
+                if (contains(task))
+                    found.push_back(task);
+
+        for (auto* task : *_internal->spatial_oversized)
+            if (contains(task))
+                found.push_back(task);
+
+        return detail::render_area_internal_spatial_collect(_internal, found);
+    }
+
+    std::vector<RenderTask> RenderArea::query_rectangle(Rectangle rectangle)
+    {
+        if (detail::is_opengl_disabled())
+            return {};
+
+        detail::render_area_internal_spatial_refresh(_internal);
+
+        auto min = Vector2f(rectangle.top_left.x, rectangle.top_left.y - rectangle.size.y);
+        auto max = Vector2f(rectangle.top_left.x + rectangle.size.x, rectangle.top_left.y);
+
+        auto overlaps = [&](const detail::SpatialIndexEntry& entry) -> bool {
+            return not (entry.max.x < min.x or entry.min.x > max.x or entry.max.y < min.y or entry.min.y > max.y);
+        };
+
+        std::vector<detail::RenderTaskInternal*> found;
+
+        auto cell_min = Vector2i(detail::render_area_internal_spatial_cell(min.x), detail::render_area_internal_spatial_cell(min.y));
+        auto cell_max = Vector2i(detail::render_area_internal_spatial_cell(max.x), detail::render_area_internal_spatial_cell(max.y));
+        auto n_cells = uint64_t(int64_t(cell_max.x) - cell_min.x + 1) * uint64_t(int64_t(cell_max.y) - cell_min.y + 1);
+
+        if (n_cells > _internal->spatial_entries->size())
+        {
+            // visiting every cell would be slower than testing every task
+            for (auto& pair : *_internal->spatial_entries)
+                if (pair.second.is_bounded and overlaps(pair.second))
+                    found.push_back(pair.first);
+        }
+        else
+        {
+            for (int32_t x = cell_min.x; x <= cell_max.x; ++x)
+            {
+                for (int32_t y = cell_min.y; y <= cell_max.y; ++y)
+                {
+                    auto cell_it = _internal->spatial_cells->find(detail::render_area_internal_spatial_key(x, y));
+                    if (cell_it == _internal->spatial_cells->end())
+                        continue;
+
+                    for (auto* task : cell_it->second)
+                    {
+                        const auto& entry = _internal->spatial_entries->at(task);
+
+                        // a task spanning several cells is only reported from the first cell it shares with the rectangle
+                        if (x != std::max(entry.cell_min.x, cell_min.x) or y != std::max(entry.cell_min.y, cell_min.y))
+                            continue;
+
+                        if (overlaps(entry))
+                            found.push_back(task);
+                    }
+                }
+            }
+
+            for (auto* task : *_internal->spatial_oversized)
+                if (overlaps(_internal->spatial_entries->at(task)))
+                    found.push_back(task);
+        }
+
+        return detail::render_area_internal_spatial_collect(_internal, found);
+    }
+
+    void RenderArea::set_culling_enabled(bool b)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->culling_enabled = b;
+        _internal->frame_cache_valid = false;
+    }
+
+    bool RenderArea::get_culling_enabled() const
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        return _internal->culling_enabled;
+    }
+
+    void RenderArea::flush()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        glFlush();
+    }
+
+    void RenderArea::clear()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClearColor(0, 0, 0, 0);
+    }
+
+    GdkGLContext* RenderArea::on_create_context(GtkGLArea* area, GdkGLContext* context, detail::RenderAreaInternal* internal)
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        detail::initialize_opengl();
+        g_object_ref(detail::GL_CONTEXT);
+        gdk_gl_context_make_current(detail::GL_CONTEXT);
+        return detail::GL_CONTEXT;
+    }
+
+    void RenderArea::on_realize(GtkWidget* area, detail::RenderAreaInternal* internal)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        gtk_gl_area_queue_render(GTK_GL_AREA(area));
+    }
+
+    void RenderArea::on_resize(GtkGLArea* area, gint width, gint height, detail::RenderAreaInternal* internal)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        assert(GDK_IS_GL_CONTEXT(detail::GL_CONTEXT));
+
+        gtk_gl_area_make_current(area);
+
+        if (internal->apply_msaa)
+            internal->render_texture->create(width, height);
+
+        if (internal->frame_cache != nullptr)
+            internal->frame_cache->create(width, height);
+
+        internal->frame_cache_valid = false;
+        gtk_gl_area_queue_render(area);
+    }
+
+    gboolean RenderArea::on_render(GtkGLArea* area, GdkGLContext* context, detail::RenderAreaInternal* internal)
+    {
+        if (detail::is_opengl_disabled())
+            return FALSE;
+
+        assert(GDK_IS_GL_CONTEXT(detail::GL_CONTEXT));
+        gtk_gl_area_make_current(area);
+
+        // GTK may have touched the context since the last frame
+        detail::gl_state_invalidate();
+        detail::render_area_internal_begin_frame_statistics(internal);
+
+        // finishing a shader changes the version of its tasks, so this has to happen before the frame cache is checked
+        auto is_compiling = detail::render_area_internal_advance_shaders(internal);
+
+        if (internal->render_on_demand_enabled)
+        {
+            if (not internal->apply_msaa and internal->frame_cache == nullptr)
+            {
+                GLint viewport[4];
+                glGetIntegerv(GL_VIEWPORT, viewport);
+
+                internal->frame_cache = new RenderTexture();
+                ((detail::RenderTextureInternal*) internal->frame_cache->get_internal())->bucketed = true;
+                internal->frame_cache->create(viewport[2], viewport[3]);
+                detail::render_area_internal_create_present_task(internal, internal->frame_cache);
+            }
+
+            // only re-execute tasks if any of their inputs changed, otherwise the previous frame is still in the cache
+            auto version = detail::render_area_internal_get_version(internal);
+            if (not internal->frame_cache_valid or version != internal->frame_cache_version)
+            {
+                if (internal->apply_msaa)
+                    internal->render_texture->bind_as_render_target();
+                else
+                    internal->frame_cache->bind_as_render_target();
+
+                RenderArea::clear();
+                set_current_blend_mode(BlendMode::NORMAL);
+
+                detail::render_area_internal_render_tasks(internal);
+
+                RenderArea::flush();
+
+                if (internal->apply_msaa)
+                    internal->render_texture->unbind_as_render_target_and_resolve();
+                else
+                    internal->frame_cache->unbind_as_render_target();
+
+                internal->frame_cache_valid = true;
+                internal->frame_cache_version = version;
+            }
+            else
+            {
+                internal->n_batches = 0;
+
+                // the multi-sampled buffer still holds the last frame, so it can be resolved again as is
+                if (internal->apply_msaa)
+                    internal->render_texture->resolve_to_current_render_target();
+            }
+
+            if (not internal->apply_msaa)
+            {
+                RenderArea::clear();
+                set_current_blend_mode(BlendMode::NORMAL);
+
+                detail::render_area_internal_update_present_task(internal);
+                internal->render_texture_shape_task->render();
+            }
+
+            RenderArea::flush();
+        }
+        else if (internal->apply_msaa)
+        {
+            internal->render_texture->bind_as_render_target();
+
+            RenderArea::clear();
+            set_current_blend_mode(BlendMode::NORMAL);
+
+            detail::render_area_internal_render_tasks(internal);
+
+            // resolving straight into the areas framebuffer replaces copying the frame into a texture and drawing that texture again
+            internal->render_texture->unbind_as_render_target_and_resolve();
+            RenderArea::flush();
+        }
+        else
+        {
+            RenderArea::clear();
+            set_current_blend_mode(BlendMode::NORMAL);
+
+            detail::render_area_internal_render_tasks(internal);
+
+            RenderArea::flush();
+        }
+
+        detail::render_area_internal_end_frame_statistics(internal);
+
+        // keep producing frames until all shaders are done, otherwise compilation would stall
+        if (is_compiling)
+            gtk_gl_area_queue_render(area);
+
+        return TRUE;
+    }
+
+    void RenderArea::render_render_tasks()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        // may be called from a user render handler that issued its own GL calls
+        detail::gl_state_invalidate();
+
+        detail::render_area_internal_render_tasks(_internal);
+    }
+
+    void RenderArea::set_batching_enabled(bool b)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->batching_enabled = b;
+    }
+
+    bool RenderArea::get_batching_enabled() const
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        return _internal->batching_enabled;
+    }
+
+    uint64_t RenderArea::get_n_batches() const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return _internal->n_batches;
+    }
+
+    void RenderArea::set_frame_statistics_enabled(bool b)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->statistics_enabled = b;
+    }
+
+    bool RenderArea::get_frame_statistics_enabled() const
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        return _internal->statistics_enabled;
+    }
+
+    void RenderArea::set_gpu_timing_enabled(bool b)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->gpu_timing_enabled = b;
+    }
+
+    bool RenderArea::get_gpu_timing_enabled() const
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        return _internal->gpu_timing_enabled;
+    }
+
+    FrameStatistics RenderArea::get_frame_statistics() const
+    {
+        if (detail::is_opengl_disabled())
+            return FrameStatistics();
+
+        return *_internal->statistics;
+    }
+
+    void RenderArea::set_render_on_demand_enabled(bool b)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->render_on_demand_enabled = b;
+        _internal->frame_cache_valid = false;
+    }
+
+    bool RenderArea::get_render_on_demand_enabled() const
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        return _internal->render_on_demand_enabled;
+    }
+
+    void RenderArea::invalidate_frame_cache()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->frame_cache_valid = false;
+        gtk_gl_area_queue_render(_internal->native);
     }
 
     void RenderArea::queue_render()
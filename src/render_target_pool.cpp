@@ -0,0 +1,249 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/render_target_pool.hpp>
+#include <mousetrap/render_area.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        static std::vector<RenderTargetAllocation*> RENDER_TARGET_POOL = {};
+        static gint64 RENDER_TARGET_POOL_SHRINK_TIMEOUT_US = 5 * G_USEC_PER_SEC;
+        static guint RENDER_TARGET_POOL_SHRINK_SOURCE = 0;
+
+        static constexpr int32_t RENDER_TARGET_POOL_BUCKET_SIZE = 256;
+
+        static void render_target_pool_free(RenderTargetAllocation* allocation)
+        {
+            make_opengl_context_current();
+            gl_state_forget_texture(allocation->texture);
+            glDeleteTextures(1, &allocation->texture);
+            delete allocation;
+        }
+
+        static void render_target_pool_free_unused(gint64 unused_since)
+        {
+            auto& pool = RENDER_TARGET_POOL;
+            auto it = std::remove_if(pool.begin(), pool.end(), [&](RenderTargetAllocation* allocation){
+                if (allocation->in_use or allocation->last_used > unused_since)
+                    return false;
+
+                render_target_pool_free(allocation);
+                return true;
+            });
+            pool.erase(it, pool.end());
+        }
+
+        static gboolean render_target_pool_shrink(void*)
+        {
+            auto now = g_get_monotonic_time();
+            render_target_pool_free_unused(now - RENDER_TARGET_POOL_SHRINK_TIMEOUT_US);
+
+            auto any_unused = std::any_of(RENDER_TARGET_POOL.begin(), RENDER_TARGET_POOL.end(), [](RenderTargetAllocation* allocation){
+                return not allocation->in_use;
+            });
+
+            if (any_unused)
+                return G_SOURCE_CONTINUE;
+
+            RENDER_TARGET_POOL_SHRINK_SOURCE = 0;
+            return G_SOURCE_REMOVE;
+        }
+
+        Vector2i render_target_pool_get_bucket(Vector2i size)
+        {
+            auto round = [](int32_t x) -> int32_t {
+                x = std::max(x, 1);
+                if (x <= RENDER_TARGET_POOL_BUCKET_SIZE)
+                {
+                    int32_t out = 1;
+                    while (out < x)
+                        out *= 2;
+
+                    return out;
+                }
+
+                return ((x + RENDER_TARGET_POOL_BUCKET_SIZE - 1) / RENDER_TARGET_POOL_BUCKET_SIZE) * RENDER_TARGET_POOL_BUCKET_SIZE;
+            };
+
+            return Vector2i(round(size.x), round(size.y));
+        }
+
+        // attachments are never empty, such that the framebuffer they are attached to is complete
+        static Vector2i render_target_pool_get_exact(Vector2i size)
+        {
+            return Vector2i(std::max<int32_t>(size.x, 1), std::max<int32_t>(size.y, 1));
+        }
+
+        static bool render_target_pool_fits(RenderTargetAllocation* allocation, Vector2i size, uint64_t n_samples, bool bucketed)
+        {
+            if (allocation->n_samples != n_samples)
+                return false;
+
+            if (not bucketed)
+                return allocation->size == render_target_pool_get_exact(size);
+
+            return allocation->size.x >= size.x and allocation->size.y >= size.y;
+        }
+
+        static void render_target_pool_update_oversized(RenderTargetAllocation* allocation, Vector2i size, gint64 now)
+        {
+            if (allocation->size == render_target_pool_get_bucket(size) or allocation->size == render_target_pool_get_exact(size))
+                allocation->oversized_since = -1;
+            else if (allocation->oversized_since < 0)
+                allocation->oversized_since = now;
+        }
+
+        RenderTargetAllocation* render_target_pool_acquire(Vector2i size, uint64_t n_samples, bool bucketed)
+        {
+            auto now = g_get_monotonic_time();
+
+            // reuse the smallest unused attachment that fits
+            RenderTargetAllocation* best = nullptr;
+            for (auto* allocation : RENDER_TARGET_POOL)
+            {
+                if (allocation->in_use or not render_target_pool_fits(allocation, size, n_samples, bucketed))
+                    continue;
+
+                if (best == nullptr or allocation->size.x * allocation->size.y < best->size.x * best->size.y)
+                    best = allocation;
+            }
+
+            if (best != nullptr)
+            {
+                best->in_use = true;
+                best->last_used = now;
+                render_target_pool_update_oversized(best, size, now);
+                return best;
+            }
+
+            auto* allocation = new RenderTargetAllocation();
+            allocation->n_samples = n_samples;
+            allocation->size = bucketed ? render_target_pool_get_bucket(size) : render_target_pool_get_exact(size);
+            allocation->in_use = true;
+            allocation->last_used = now;
+            allocation->oversized_since = -1;
+
+            make_opengl_context_current();
+            glGenTextures(1, &allocation->texture);
+
+            if (n_samples == 0)
+            {
+                gl_state_bind_texture(0, allocation->texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, allocation->size.x, allocation->size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+                // the default filter samples from mipmaps, which render targets do not have
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            }
+            else
+            {
+                glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, allocation->texture);
+                glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, n_samples, GL_RGBA8, allocation->size.x, allocation->size.y, GL_TRUE);
+                glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+            }
+
+            RENDER_TARGET_POOL.push_back(allocation);
+            return allocation;
+        }
+
+        void render_target_pool_release(RenderTargetAllocation* allocation)
+        {
+            if (allocation == nullptr)
+                return;
+
+            allocation->in_use = false;
+            allocation->last_used = g_get_monotonic_time();
+
+            if (RENDER_TARGET_POOL_SHRINK_SOURCE == 0)
+            {
+                static constexpr guint poll_interval_s = 1;
+                RENDER_TARGET_POOL_SHRINK_SOURCE = g_timeout_add_seconds(poll_interval_s, render_target_pool_shrink, nullptr);
+            }
+        }
+
+        RenderTargetAllocation* render_target_pool_resize(RenderTargetAllocation* allocation, Vector2i size, uint64_t n_samples, bool bucketed)
+        {
+            if (allocation != nullptr and render_target_pool_fits(allocation, size, n_samples, bucketed))
+            {
+                auto now = g_get_monotonic_time();
+                allocation->last_used = now;
+                render_target_pool_update_oversized(allocation, size, now);
+
+                if (allocation->oversized_since < 0 or now - allocation->oversized_since < RENDER_TARGET_POOL_SHRINK_TIMEOUT_US)
+                    return allocation;
+            }
+
+            // acquire first, such that the released attachment is not handed out again
+            auto* out = render_target_pool_acquire(size, n_samples, bucketed);
+            render_target_pool_release(allocation);
+            return out;
+        }
+
+        Rectangle render_target_pool_get_texture_rectangle(RenderTargetAllocation* allocation, Vector2i size)
+        {
+            if (allocation == nullptr or allocation->size.x == 0 or allocation->size.y == 0)
+                return Rectangle{{0, 0}, {1, 1}};
+
+            return Rectangle{
+                {0, 0},
+                {float(size.x) / allocation->size.x, float(size.y) / allocation->size.y}
+            };
+        }
+    }
+
+    void RenderTargetPool::set_shrink_timeout(Time duration)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::RENDER_TARGET_POOL_SHRINK_TIMEOUT_US = std::max<gint64>(duration.as_microseconds(), 0);
+    }
+
+    Time RenderTargetPool::get_shrink_timeout()
+    {
+        if (detail::is_opengl_disabled())
+            return microseconds(0);
+
+        return microseconds(detail::RENDER_TARGET_POOL_SHRINK_TIMEOUT_US);
+    }
+
+    void RenderTargetPool::clear()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::render_target_pool_free_unused(std::numeric_limits<gint64>::max());
+    }
+
+    uint64_t RenderTargetPool::get_n_allocations()
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return detail::RENDER_TARGET_POOL.size();
+    }
+
+    uint64_t RenderTargetPool::get_n_bytes_allocated()
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        uint64_t out = 0;
+        for (auto* allocation : detail::RENDER_TARGET_POOL)
+            out += uint64_t(allocation->size.x) * allocation->size.y * 4 * std::max<uint64_t>(allocation->n_samples, 1);
+
+        return out;
+    }
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
@@ -10,6 +10,8 @@
 #include <mousetrap/render_task.hpp>
 #include <mousetrap/log.hpp>
 #include <iostream>
+#include <cstring>
+#include <limits>
 
 namespace mousetrap
 {
@@ -25,16 +27,16 @@ namespace mousetrap
             if (detail::is_opengl_disabled())
                 return;
 
-            delete self->_floats;
-            delete self->_ints;
-            delete self->_uints;
-            delete self->_vec2s;
-            delete self->_vec3s;
-            delete self->_vec4s;
-            delete self->_transforms;
+            delete self->_uniforms;
 
             g_object_unref(self->_shape);
             g_object_unref(self->_shader);
+
+            if (self->_fallback_shader != nullptr)
+                g_object_unref(self->_fallback_shader);
+
+            g_object_unref(self->_noop_untextured);
+            g_object_unref(self->_noop_textured);
         }
 
         DEFINE_NEW_TYPE_TRIVIAL_INIT(RenderTaskInternal, render_task_internal, RENDER_TASK_INTERNAL)
@@ -61,13 +63,26 @@ namespace mousetrap
             else
                 self->_shader = (detail::ShaderInternal*) shader->operator GObject*();
 
-            self->_floats = new std::map<std::string, float>();
-            self->_ints = new std::map<std::string, int>();
-            self->_uints = new std::map<std::string, glm::uint>();
-            self->_vec2s = new std::map<std::string, Vector2f>();
-            self->_vec3s = new std::map<std::string, Vector3f>();
-            self->_vec4s = new std::map<std::string, Vector4f>();
-            self->_transforms = new std::map<std::string, GLTransform>();
+            self->_fallback_shader = nullptr;
+
+            if (self->noop_shader_variant == nullptr)
+            {
+                self->noop_shader_variant = new ShaderVariant();
+                self->noop_textured_flag = self->noop_shader_variant->add_define("MOUSETRAP_TEXTURED");
+            }
+
+            self->_noop_untextured = (detail::ShaderInternal*) self->noop_shader_variant->get_shader(0).operator GObject*();
+            self->_noop_textured = (detail::ShaderInternal*) self->noop_shader_variant->get_shader(self->noop_textured_flag).operator GObject*();
+            g_object_ref(self->_noop_untextured);
+            g_object_ref(self->_noop_textured);
+
+            self->_uniforms = new std::vector<UniformBinding>();
+            self->_uniforms_program_id = 0;
+            self->_uniforms_shader_version = 0;
+            self->_version = render_state_next_version();
+
+            self->_bounds_version = std::numeric_limits<uint64_t>::max();
+            self->_is_bounded = false;
 
             self->_transform = transform;
             self->_blend_mode = blend_mode;
@@ -77,6 +92,212 @@ namespace mousetrap
 
             return self;
         }
+
+        static uint64_t uniform_type_n_bytes(UniformType type)
+        {
+            if (type == UniformType::FLOAT)
+                return sizeof(float);
+            else if (type == UniformType::INT)
+                return sizeof(GLint);
+            else if (type == UniformType::UINT)
+                return sizeof(GLuint);
+            else if (type == UniformType::VEC2)
+                return 2 * sizeof(float);
+            else if (type == UniformType::VEC3)
+                return 3 * sizeof(float);
+            else if (type == UniformType::VEC4)
+                return 4 * sizeof(float);
+            else
+                return 16 * sizeof(float);
+        }
+
+        static UniformBinding* render_task_internal_find_uniform(RenderTaskInternal* self, const std::string& name)
+        {
+            for (auto& uniform : *self->_uniforms)
+                if (uniform.name == name)
+                    return &uniform;
+
+            return nullptr;
+        }
+
+        static const UniformBinding* render_task_internal_get_uniform(RenderTaskInternal* self, const std::string& name, UniformType type)
+        {
+            auto* uniform = render_task_internal_find_uniform(self, name);
+            if (uniform == nullptr or uniform->type != type)
+                return nullptr;
+
+            return uniform;
+        }
+
+        static UniformBinding& render_task_internal_add_uniform(RenderTaskInternal* self, const std::string& name, UniformType type)
+        {
+            auto* uniform = render_task_internal_find_uniform(self, name);
+            if (uniform == nullptr)
+            {
+                self->_uniforms->emplace_back();
+                uniform = &self->_uniforms->back();
+                uniform->name = name;
+
+                if (self->_uniforms_program_id != 0)
+                    uniform->location = shader_internal_get_uniform_location(render_task_internal_get_shader(self), self->_uniforms_program_id, name);
+            }
+
+            uniform->type = type;
+            self->_version = render_state_next_version();
+            return *uniform;
+        }
+
+        ShaderInternal* render_task_internal_get_shader(RenderTaskInternal* self)
+        {
+            auto* noop = (ShaderInternal*) self->noop_shader->operator GObject*();
+
+            if (self->_shader != noop and shader_internal_is_ready(self->_shader))
+                return self->_shader;
+
+            if (self->_fallback_shader != nullptr and self->_fallback_shader != noop and shader_internal_is_ready(self->_fallback_shader))
+                return self->_fallback_shader;
+
+            // called several times per task and frame, so this must not go through ShaderVariant::get_shader
+            return self->_shape->texture != nullptr ? self->_noop_textured : self->_noop_untextured;
+        }
+
+        void render_task_internal_advance_shaders(RenderTaskInternal* self)
+        {
+            shader_internal_advance(self->_shader);
+            if (self->_fallback_shader != nullptr)
+                shader_internal_advance(self->_fallback_shader);
+        }
+
+        void render_task_internal_apply_state(RenderTaskInternal* self)
+        {
+            auto* shader = render_task_internal_get_shader(self);
+
+            // shapes with an instance buffer are drawn with the instanced variant of the program, so uniforms have to go there
+            auto program_id = self->_shape->instance_buffer != nullptr ? Shader(shader).get_instanced_program_id() : shader->program_id;
+            gl_state_use_program(program_id);
+
+            // locations are only looked up when the program changes, not every frame. Drivers may hand out the name of a deleted program again, so relinking is detected through the shaders version
+            if (self->_uniforms_program_id != program_id or self->_uniforms_shader_version != shader->version)
+            {
+                for (auto& uniform : *self->_uniforms)
+                    uniform.location = shader_internal_get_uniform_location(shader, program_id, uniform.name);
+
+                self->_uniforms_program_id = program_id;
+                self->_uniforms_shader_version = shader->version;
+            }
+
+            for (auto& uniform : *self->_uniforms)
+            {
+                const auto& value = uniform.value;
+                if (uniform.type == UniformType::FLOAT)
+                    glUniform1f(uniform.location, value.floats[0]);
+                else if (uniform.type == UniformType::INT)
+                    glUniform1i(uniform.location, value.int_value);
+                else if (uniform.type == UniformType::UINT)
+                    glUniform1ui(uniform.location, value.uint_value);
+                else if (uniform.type == UniformType::VEC2)
+                    glUniform2fv(uniform.location, 1, value.floats);
+                else if (uniform.type == UniformType::VEC3)
+                    glUniform3fv(uniform.location, 1, value.floats);
+                else if (uniform.type == UniformType::VEC4)
+                    glUniform4fv(uniform.location, 1, value.floats);
+                else if (uniform.type == UniformType::TRANSFORM)
+                    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, value.floats);
+            }
+
+            set_current_blend_mode(self->_blend_mode);
+        }
+
+        bool render_task_internal_get_bounds(RenderTaskInternal* self, Vector2f& min, Vector2f& max)
+        {
+            auto* shape = self->_shape;
+            // the fallback may be rendered instead, so it has to use the default vertex shader as well
+            if (shape->instance_buffer != nullptr or self->_shader->vertex_source != nullptr)
+                return false;
+
+            if (self->_fallback_shader != nullptr and self->_fallback_shader->vertex_source != nullptr)
+                return false;
+
+            if (self->_bounds_version != shape->geometry_version)
+            {
+                Vector3f shape_min, shape_max;
+                shape_internal_get_bounds(shape, shape_min, shape_max);
+
+                auto lowest = std::numeric_limits<float>::lowest();
+                auto highest = std::numeric_limits<float>::max();
+                self->_bounds_min = Vector2f(highest, highest);
+                self->_bounds_max = Vector2f(lowest, lowest);
+                self->_is_bounded = true;
+
+                // the corners of the transformed bounding box enclose the transformed shape
+                for (uint64_t i = 0; i < 8; ++i)
+                {
+                    auto corner = glm::vec4(
+                        i & 1 ? shape_max.x : shape_min.x,
+                        i & 2 ? shape_max.y : shape_min.y,
+                        i & 4 ? shape_max.z : shape_min.z,
+                        1
+                    );
+
+                    auto transformed = self->_transform.transform * corner;
+                    if (transformed.w <= 0)
+                    {
+                        self->_is_bounded = false;
+                        break;
+                    }
+
+                    auto position = Vector2f(transformed.x / transformed.w, transformed.y / transformed.w);
+                    self->_bounds_min = glm::min(self->_bounds_min, position);
+                    self->_bounds_max = glm::max(self->_bounds_max, position);
+                }
+
+                self->_bounds_version = shape->geometry_version;
+            }
+
+            min = self->_bounds_min;
+            max = self->_bounds_max;
+            return self->_is_bounded;
+        }
+
+        uint64_t render_task_internal_get_version(RenderTaskInternal* self)
+        {
+            auto out = std::max(self->_version, shape_internal_get_version(self->_shape));
+            out = std::max(out, self->_shader->version);
+
+            if (self->_fallback_shader != nullptr)
+                out = std::max(out, self->_fallback_shader->version);
+
+            return out;
+        }
+
+        bool render_task_internal_has_same_state(RenderTaskInternal* a, RenderTaskInternal* b)
+        {
+            if (a == b)
+                return true;
+
+            if (render_task_internal_get_shader(a) != render_task_internal_get_shader(b) or a->_blend_mode != b->_blend_mode or a->_shape->texture != b->_shape->texture)
+                return false;
+
+            if (a->_transform.transform != b->_transform.transform)
+                return false;
+
+            if (a->_uniforms->size() != b->_uniforms->size())
+                return false;
+
+            for (uint64_t i = 0; i < a->_uniforms->size(); ++i)
+            {
+                const auto& a_uniform = a->_uniforms->at(i);
+                const auto& b_uniform = b->_uniforms->at(i);
+
+                if (a_uniform.type != b_uniform.type or a_uniform.name != b_uniform.name)
+                    return false;
+
+                if (std::memcmp(&a_uniform.value, &b_uniform.value, uniform_type_n_bytes(a_uniform.type)) != 0)
+                    return false;
+            }
+
+            return true;
+        }
     }
 
     RenderTask::RenderTask(const Shape& shape, const Shader* shader, const GLTransform& transform, BlendMode blend_mode)
@@ -107,43 +328,75 @@ namespace mousetrap
         g_object_unref(_internal);
     }
 
-    void RenderTask::render() const
+    RenderTask::RenderTask(const RenderTask& other)
     {
         if (detail::is_opengl_disabled())
             return;
 
-        auto shader = Shader(_internal->_shader);
+        _internal = g_object_ref(other._internal);
+    }
+
+    RenderTask& RenderTask::operator=(const RenderTask& other)
+    {
+        if (detail::is_opengl_disabled())
+            return *this;
+
+        if (&other == this)
+            return *this;
+
+        g_object_ref(other._internal);
+        g_object_unref(_internal);
+        _internal = other._internal;
+        return *this;
+    }
+
+    void RenderTask::render() const
+    {
+        if (detail::is_opengl_disabled())
+            return;
 
-        glUseProgram(shader.get_program_id());
+        // asynchronous compilation progresses by one step every time the task is rendered
+        detail::render_task_internal_advance_shaders(_internal);
+        detail::render_task_internal_apply_state(_internal);
 
-        for (auto& pair : *_internal->_floats)
-            shader.set_uniform_float(pair.first, pair.second);
+        auto shape = Shape(_internal->_shape);
+        shape.render(Shader(detail::render_task_internal_get_shader(_internal)), _internal->_transform);
+    }
 
-        for (auto& pair : *_internal->_ints)
-            shader.set_uniform_int(pair.first, pair.second);
+    void RenderTask::set_shader_variant(const ShaderVariant& variant, uint64_t flags)
+    {
+        if (detail::is_opengl_disabled())
+            return;
 
-        for (auto& pair : *_internal->_uints)
-            shader.set_uniform_uint(pair.first, pair.second);
+        auto* shader = (detail::ShaderInternal*) variant.get_shader(flags).operator GObject*();
+        if (shader == _internal->_shader)
+            return;
 
-        for (auto& pair : *_internal->_vec2s)
-            shader.set_uniform_vec2(pair.first, pair.second);
+        // the permutation is kept alive by the task, even if the variant cache is cleared
+        g_object_ref(shader);
+        g_object_unref(_internal->_shader);
+        _internal->_shader = shader;
 
-        for (auto& pair : *_internal->_vec3s)
-            shader.set_uniform_vec3(pair.first, pair.second);
+        _internal->_uniforms_program_id = 0;
+        _internal->_version = detail::render_state_next_version();
+        detail::SHADER_PROGRAM_VERSION += 1;
+    }
 
-        for (auto& pair : *_internal->_vec4s)
-            shader.set_uniform_vec4(pair.first, pair.second);
+    void RenderTask::set_fallback_shader(const Shader* shader)
+    {
+        if (detail::is_opengl_disabled())
+            return;
 
-        for (auto& pair :*_internal-> _transforms)
-            shader.set_uniform_transform(pair.first, pair.second);
+        if (_internal->_fallback_shader != nullptr)
+            g_object_unref(_internal->_fallback_shader);
 
-        glEnable(GL_BLEND);
-        set_current_blend_mode(_internal->_blend_mode);
+        _internal->_fallback_shader = shader != nullptr ? (detail::ShaderInternal*) shader->operator GObject*() : nullptr;
 
-        auto shape = Shape(_internal->_shape);
-        shape.render(shader, _internal->_transform);
+        if (_internal->_fallback_shader != nullptr)
+            g_object_ref(_internal->_fallback_shader);
 
-        set_current_blend_mode(BlendMode::NORMAL);
+        _internal->_version = detail::render_state_next_version();
+        detail::SHADER_PROGRAM_VERSION += 1;
     }
 
     void RenderTask::set_uniform_float(const std::string& uniform_name, float value)
@@ -151,7 +404,8 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->_floats->insert({uniform_name, value});
+        auto& uniform = detail::render_task_internal_add_uniform(_internal, uniform_name, detail::UniformType::FLOAT);
+        uniform.value.floats[0] = value;
     }
 
     void RenderTask::set_uniform_int(const std::string& uniform_name, int value)
@@ -159,7 +413,8 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->_ints->insert({uniform_name, value});
+        auto& uniform = detail::render_task_internal_add_uniform(_internal, uniform_name, detail::UniformType::INT);
+        uniform.value.int_value = value;
     }
 
     void RenderTask::set_uniform_uint(const std::string& uniform_name, glm::uint value)
@@ -167,7 +422,8 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->_uints->insert({uniform_name, value});
+        auto& uniform = detail::render_task_internal_add_uniform(_internal, uniform_name, detail::UniformType::UINT);
+        uniform.value.uint_value = value;
     }
 
     void RenderTask::set_uniform_vec2(const std::string& uniform_name, Vector2f value)
@@ -175,7 +431,9 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->_vec2s->insert({uniform_name, value});
+        auto& uniform = detail::render_task_internal_add_uniform(_internal, uniform_name, detail::UniformType::VEC2);
+        uniform.value.floats[0] = value.x;
+        uniform.value.floats[1] = value.y;
     }
 
     void RenderTask::set_uniform_vec3(const std::string& uniform_name, Vector3f value)
@@ -183,7 +441,10 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->_vec3s->insert({uniform_name, value});
+        auto& uniform = detail::render_task_internal_add_uniform(_internal, uniform_name, detail::UniformType::VEC3);
+        uniform.value.floats[0] = value.x;
+        uniform.value.floats[1] = value.y;
+        uniform.value.floats[2] = value.z;
     }
 
     void RenderTask::set_uniform_vec4(const std::string& uniform_name, Vector4f value)
@@ -191,7 +452,11 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->_vec4s->insert({uniform_name, value});
+        auto& uniform = detail::render_task_internal_add_uniform(_internal, uniform_name, detail::UniformType::VEC4);
+        uniform.value.floats[0] = value.x;
+        uniform.value.floats[1] = value.y;
+        uniform.value.floats[2] = value.z;
+        uniform.value.floats[3] = value.w;
     }
 
     void RenderTask::set_uniform_transform(const std::string& uniform_name, GLTransform value)
@@ -199,7 +464,8 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->_transforms->insert({uniform_name, value});
+        auto& uniform = detail::render_task_internal_add_uniform(_internal, uniform_name, detail::UniformType::TRANSFORM);
+        std::memcpy(uniform.value.floats, &(value.transform[0][0]), sizeof(uniform.value.floats));
     }
 
     void RenderTask::set_uniform_rgba(const std::string& uniform_name, RGBA value)
@@ -223,13 +489,13 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return 0;
 
-        auto it = _internal->_floats->find(uniform_name);
-        if (it == _internal->_floats->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::FLOAT);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_float: No float with name `" + uniform_name + "` registered");
             return 0;
         }
-        return it->second;
+        return uniform->value.floats[0];
     }
 
     glm::int32_t RenderTask::get_uniform_int(const std::string& uniform_name) const
@@ -237,13 +503,13 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return 0;
 
-        auto it = _internal->_ints->find(uniform_name);
-        if (it == _internal->_ints->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::INT);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_int: No int with name `" + uniform_name + "` registered");
             return 0;
         }
-        return it->second;
+        return uniform->value.int_value;
     }
 
     glm::uint RenderTask::get_uniform_uint(const std::string& uniform_name) const
@@ -251,13 +517,13 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return 0;
 
-        auto it = _internal->_uints->find(uniform_name);
-        if (it == _internal->_uints->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::UINT);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_uint: No uint with name `" + uniform_name + "` registered");
             return 0;
         }
-        return it->second;
+        return uniform->value.uint_value;
     }
 
     Vector2f RenderTask::get_uniform_vec2(const std::string& uniform_name) const
@@ -265,13 +531,13 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return {0, 0};
 
-        auto it = _internal->_vec2s->find(uniform_name);
-        if (it == _internal->_vec2s->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::VEC2);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_vec2: No vec2 with name `" + uniform_name + "` registered");
             return {0, 0};
         }
-        return it->second;
+        return Vector2f(uniform->value.floats[0], uniform->value.floats[1]);
     }
 
     Vector3f RenderTask::get_uniform_vec3(const std::string& uniform_name) const
@@ -279,13 +545,13 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return {0, 0, 0};
 
-        auto it = _internal->_vec3s->find(uniform_name);
-        if (it == _internal->_vec3s->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::VEC3);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_vec3: No vec3 with name `" + uniform_name + "` registered");
             return {0, 0, 0};
         }
-        return it->second;
+        return Vector3f(uniform->value.floats[0], uniform->value.floats[1], uniform->value.floats[2]);
     }
 
     Vector4f RenderTask::get_uniform_vec4(const std::string& uniform_name) const
@@ -293,13 +559,14 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return {0, 0, 0, 0};
 
-        auto it = _internal->_vec4s->find(uniform_name);
-        if (it == _internal->_vec4s->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::VEC4);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_vec4: No vec4 with name `" + uniform_name + "` registered");
             return {0, 0, 0, 0};
         }
-        return it->second;
+        const auto* out = uniform->value.floats;
+        return Vector4f(out[0], out[1], out[2], out[3]);
     }
 
     RGBA RenderTask::get_uniform_rgba(const std::string& uniform_name) const
@@ -307,14 +574,14 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return RGBA(0, 0, 0, 0);
 
-        auto it = _internal->_vec4s->find(uniform_name);
-        if (it == _internal->_vec4s->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::VEC4);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_rgba: No vec4 with name `" + uniform_name + "` registered");
             return {0, 0, 0, 0};
         }
-        auto out = it->second;
-        return RGBA(out.x, out.y, out.z, out.w);
+        const auto* out = uniform->value.floats;
+        return RGBA(out[0], out[1], out[2], out[3]);
     }
 
     HSVA RenderTask::get_uniform_hsva(const std::string& uniform_name) const
@@ -322,14 +589,14 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return HSVA(0, 0, 0, 0);
 
-        auto it = _internal->_vec4s->find(uniform_name);
-        if (it == _internal->_vec4s->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::VEC4);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_hsva: No vec4 with name `" + uniform_name + "` registered");
             return {0, 0, 0, 0};
         }
-        auto out = it->second;
-        return HSVA(out.x, out.y, out.z, out.w);
+        const auto* out = uniform->value.floats;
+        return HSVA(out[0], out[1], out[2], out[3]);
     }
 
     GLTransform RenderTask::get_uniform_transform(const std::string& uniform_name) const
@@ -337,13 +604,15 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return GLTransform();
 
-        auto it = _internal->_transforms->find(uniform_name);
-        if (it == _internal->_transforms->end())
+        auto* uniform = detail::render_task_internal_get_uniform(_internal, uniform_name, detail::UniformType::TRANSFORM);
+        if (uniform == nullptr)
         {
             log::critical("In RenderTask::get_uniform_transform: No mat4x4 with name `" + uniform_name + "` registered");
             return GLTransform();
         }
-        return it->second;
+        auto out = GLTransform();
+        std::memcpy(&(out.transform[0][0]), uniform->value.floats, sizeof(uniform->value.floats));
+        return out;
     }
 
     RenderTask::operator GObject*() const
@@ -4,6 +4,7 @@
 
 #include <mousetrap/render_texture.hpp>
 #include <mousetrap/render_area.hpp>
+#include <mousetrap/log.hpp>
 
 namespace mousetrap
 {
@@ -36,9 +37,36 @@ namespace mousetrap
 
             glGenFramebuffers(1, &self->framebuffer_handle);
             glBindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_handle);
+            self->bucketed = false;
 
             return self;
         }
+
+        // get storage that fits the current size from the pool, the framebuffer is only re-attached if the pool handed out a different texture. New storage holds undefined content, so this may only be called when the content is cleared afterwards
+        static void render_texture_internal_fit(RenderTextureInternal* self, TextureInternal* texture)
+        {
+            auto* allocation = render_target_pool_resize(texture->render_target_allocation, *texture->size, 0, self->bucketed);
+            if (allocation == texture->render_target_allocation)
+                return;
+
+            // the texture allocated by the mousetrap::Texture constructor is replaced by pooled storage
+            if (texture->render_target_allocation == nullptr and texture->native_handle != 0)
+            {
+                gl_state_forget_texture(texture->native_handle);
+                glDeleteTextures(1, &texture->native_handle);
+            }
+
+            texture->render_target_allocation = allocation;
+            texture->native_handle = allocation->texture;
+            texture->mipmap_dirty = true;
+            texture->version = render_state_next_version();
+
+            GLint before = 0;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &before);
+            glBindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_handle);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, RENDER_TEXTURE_ATTACHMENT, GL_TEXTURE_2D, texture->native_handle, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, before);
+        }
     }
     
     RenderTexture::RenderTexture()
@@ -115,19 +143,126 @@ namespace mousetrap
         return *this;
     }
 
-    void RenderTexture::bind_as_render_target() const
+    void RenderTexture::create(uint64_t width, uint64_t height)
     {
         if (detail::is_opengl_disabled())
             return;
 
-        constexpr auto ATTACHMENT = GL_COLOR_ATTACHMENT5;
+        auto* texture = (detail::TextureInternal*) Texture::operator GObject*();
+        *texture->size = Vector2i(width, height);
 
-        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &_internal->before_buffer);
+        // only allocates if the new size does not fit into the current storage, this is also the only place oversized storage is shrunk
+        detail::render_texture_internal_fit(_internal, texture);
+
+        // storage may be reused, so it has to be cleared explicitly
+        static const GLfloat transparent[4] = {0, 0, 0, 0};
+        GLint before = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &before);
 
         glBindFramebuffer(GL_FRAMEBUFFER, _internal->framebuffer_handle);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, ATTACHMENT, GL_TEXTURE_2D, get_native_handle(), 0);
-        GLenum DrawBuffers[1] = {ATTACHMENT};
-        glDrawBuffers(1, DrawBuffers);
+        GLenum draw_buffers[1] = {detail::RENDER_TEXTURE_ATTACHMENT};
+        glDrawBuffers(1, draw_buffers);
+        glClearBufferfv(GL_COLOR, 0, transparent);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, before);
+
+        texture->mipmap_dirty = true;
+        texture->version = detail::render_state_next_version();
+    }
+
+    void RenderTexture::create_from_image(const Image& image)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto size = image.get_size();
+        if (size.x == 0 or size.y == 0)
+        {
+            log::critical("In RenderTexture::create_from_image: image has invalid size, make sure the image is initialized correctly before creating a texture", MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        // storage is owned by the pool, respecifying it with glTexImage2D would make its size disagree with the pools bookkeeping
+        create(size.x, size.y);
+
+        auto* texture = (detail::TextureInternal*) Texture::operator GObject*();
+        detail::texture_internal_clear_updates(texture);
+        detail::gl_state_bind_texture(0, texture->native_handle);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D,
+            0,
+            0, 0,
+            size.x, size.y,
+            gdk_pixbuf_get_has_alpha(image.operator GdkPixbuf*()) ? GL_RGBA : GL_RGB,
+            GL_UNSIGNED_BYTE,
+            image.data()
+        );
+        detail::gl_statistics_count_upload(image.get_data_size());
+
+        texture->mipmap_dirty = true;
+        texture->version = detail::render_state_next_version();
+    }
+
+    bool RenderTexture::create_from_file(const std::string& path)
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        auto image = Image();
+        auto out = image.create_from_file(path);
+
+        create_from_image(image);
+        return out;
+    }
+
+    void RenderTexture::set_format(TextureFormat format)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        if (format != TextureFormat::RGBA8)
+        {
+            log::critical("In RenderTexture::set_format: Render textures are always stored as TextureFormat::RGBA8, the format cannot be changed", MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        Texture::set_format(format);
+    }
+
+    Rectangle RenderTexture::get_texture_rectangle() const
+    {
+        if (detail::is_opengl_disabled())
+            return Rectangle{{0, 0}, {1, 1}};
+
+        auto* texture = (detail::TextureInternal*) Texture::operator GObject*();
+        return detail::render_target_pool_get_texture_rectangle(texture->render_target_allocation, *texture->size);
+    }
+
+    Image RenderTexture::download() const
+    {
+        if (detail::is_opengl_disabled())
+            return Image();
+
+        auto size = get_size();
+        auto out = Image();
+        out.create(size.x, size.y);
+
+        // the storage may be larger than the texture, so only the region covered by it is read
+        detail::texture_internal_read_framebuffer(_internal->framebuffer_handle, detail::RENDER_TEXTURE_ATTACHMENT, size, out.data());
+        return out;
+    }
+
+    void RenderTexture::bind_as_render_target() const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &_internal->before_buffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, _internal->framebuffer_handle);
+
+        GLenum draw_buffers[1] = {detail::RENDER_TEXTURE_ATTACHMENT};
+        glDrawBuffers(1, draw_buffers);
     }
 
     void RenderTexture::unbind_as_render_target() const
@@ -136,6 +271,11 @@ namespace mousetrap
             return;
 
         glBindFramebuffer(GL_FRAMEBUFFER, _internal->before_buffer);
+
+        // content changed, mipmapped scale modes regenerate the mip chain the next time the texture is bound
+        auto* texture = (detail::TextureInternal*) Texture::operator GObject*();
+        texture->mipmap_dirty = true;
+        texture->version = detail::render_state_next_version();
     }
 
     RenderTexture::operator GObject*() const
@@ -29,14 +29,31 @@ namespace mousetrap
             if (detail::is_opengl_disabled())
                 return;
 
-            if (self->fragment_shader_id != 0 and self->fragment_shader_id != ShaderInternal::noop_fragment_shader_id)
+            if (self->fragment_source != nullptr and self->fragment_shader_id != 0)
                 glDeleteShader(self->fragment_shader_id);
 
-            if (self->vertex_shader_id != 0 and self->vertex_shader_id != ShaderInternal::noop_vertex_shader_id)
+            if (self->vertex_source != nullptr and self->vertex_shader_id != 0)
                 glDeleteShader(self->vertex_shader_id);
 
             if (self->program_id != 0 and self->program_id != ShaderInternal::noop_program_id)
+            {
+                detail::gl_state_forget_program(self->program_id);
                 glDeleteProgram(self->program_id);
+            }
+
+            if (self->instanced_program_id != 0 and self->instanced_program_id != self->program_id)
+            {
+                detail::gl_state_forget_program(self->instanced_program_id);
+                glDeleteProgram(self->instanced_program_id);
+            }
+
+            if (self->pending_program_id != 0)
+                glDeleteProgram(self->pending_program_id);
+
+            delete self->fragment_source;
+            delete self->vertex_source;
+            delete self->uniform_cache;
+            delete self->instanced_uniform_cache;
         }
 
         DEFINE_NEW_TYPE_TRIVIAL_INIT(ShaderInternal, shader_internal, SHADER_INTERNAL)
@@ -55,11 +72,337 @@ namespace mousetrap
             }
 
             self->program_id = detail::ShaderInternal::noop_program_id;
-            self->fragment_shader_id = detail::ShaderInternal::noop_fragment_shader_id;
-            self->vertex_shader_id = detail::ShaderInternal::noop_vertex_shader_id;
+            self->fragment_shader_id = 0;
+            self->vertex_shader_id = 0;
+            self->instanced_program_id = 0;
+
+            self->fragment_source = nullptr;
+            self->vertex_source = nullptr;
+
+            self->compile_stage = ShaderCompileStage::READY;
+            self->pending_program_id = 0;
+            self->version = render_state_next_version();
+
+            self->uniform_cache = new UniformLocationCache();
+            self->instanced_uniform_cache = new UniformLocationCache();
 
             return self;
         }
+
+        // shaders that use the default code share one compiled shader
+        static GLNativeHandle& shader_internal_get_shader_id(ShaderInternal* self, ShaderType type)
+        {
+            if (type == ShaderType::FRAGMENT)
+                return self->fragment_source != nullptr ? self->fragment_shader_id : ShaderInternal::noop_fragment_shader_id;
+            else
+                return self->vertex_source != nullptr ? self->vertex_shader_id : ShaderInternal::noop_vertex_shader_id;
+        }
+
+        static const std::string& shader_internal_get_source(ShaderInternal* self, ShaderType type)
+        {
+            if (type == ShaderType::FRAGMENT)
+                return self->fragment_source != nullptr ? *self->fragment_source : Shader::noop_fragment_shader_code;
+            else
+                return self->vertex_source != nullptr ? *self->vertex_source : Shader::noop_vertex_shader_code;
+        }
+
+        static void shader_internal_query_uniforms(UniformLocationCache* cache, GLNativeHandle program_id)
+        {
+            cache->program_id = program_id;
+            cache->locations.clear();
+            cache->transform_location = -1;
+            cache->texture_set_location = -1;
+
+            if (program_id == 0)
+                return;
+
+            GLint n_uniforms = 0;
+            GLint max_length = 0;
+            glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &n_uniforms);
+            glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+            auto buffer = std::vector<char>(max_length + 1, '\0');
+            for (GLint i = 0; i < n_uniforms; ++i)
+            {
+                GLsizei length = 0;
+                GLint size = 0;
+                GLenum type = 0;
+                glGetActiveUniform(program_id, i, buffer.size(), &length, &size, &type, buffer.data());
+
+                auto name = std::string(buffer.data(), length);
+                auto location = glGetUniformLocation(program_id, name.c_str());
+                cache->locations.insert({name, location});
+
+                // arrays are reported as `name[0]`, make them accessible as `name` as well
+                static const std::string array_suffix = "[0]";
+                if (name.size() > array_suffix.size() and name.compare(name.size() - array_suffix.size(), array_suffix.size(), array_suffix) == 0)
+                    cache->locations.insert({name.substr(0, name.size() - array_suffix.size()), location});
+            }
+
+            auto transform_it = cache->locations.find("_transform");
+            if (transform_it != cache->locations.end())
+                cache->transform_location = transform_it->second;
+
+            auto texture_set_it = cache->locations.find("_texture_set");
+            if (texture_set_it != cache->locations.end())
+                cache->texture_set_location = texture_set_it->second;
+        }
+
+        UniformLocationCache* shader_internal_get_uniform_cache(ShaderInternal* self, GLNativeHandle program_id)
+        {
+            auto* cache = program_id == self->program_id ? self->uniform_cache : self->instanced_uniform_cache;
+            if (cache->program_id != program_id)
+                shader_internal_query_uniforms(cache, program_id);
+
+            return cache;
+        }
+
+        GLint shader_internal_get_uniform_location(ShaderInternal* self, GLNativeHandle program_id, const std::string& name)
+        {
+            auto* cache = shader_internal_get_uniform_cache(self, program_id);
+            auto it = cache->locations.find(name);
+            if (it != cache->locations.end())
+                return it->second;
+
+            // not an active uniform, or an array element other than the first, ask the driver once and remember the answer
+            auto location = glGetUniformLocation(program_id, name.c_str());
+            cache->locations.insert({name, location});
+            return location;
+        }
+
+        static GLNativeHandle shader_internal_begin_compile(const std::string& source, ShaderType shader_type)
+        {
+            GLNativeHandle id = glCreateShader(static_cast<GLenum>(shader_type));
+
+            const char* source_ptr = source.c_str();
+            glShaderSource(id, 1, &source_ptr, nullptr);
+            glCompileShader(id);
+
+            return id;
+        }
+
+        // querying the status blocks until the driver finished compiling
+        static bool shader_internal_end_compile(GLNativeHandle id, const std::string& source)
+        {
+            GLint compilation_success = GL_FALSE;
+            glGetShaderiv(id, GL_COMPILE_STATUS, &compilation_success);
+            if (compilation_success == GL_TRUE)
+                return true;
+
+            std::stringstream str;
+            str << "In Shader::compile_shader: compilation failed:\n"
+                << source << "\n\n";
+
+            int info_length = 0;
+            int max_length = info_length;
+
+            glGetShaderiv(id, GL_INFO_LOG_LENGTH, &max_length);
+
+            auto log = std::vector<char>();
+            log.resize(max_length);
+
+            glGetShaderInfoLog(id, max_length, &info_length, log.data());
+
+            for (auto c:log)
+                str << c;
+
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return false;
+        }
+
+        static GLNativeHandle shader_internal_compile(const std::string& source, ShaderType shader_type)
+        {
+            auto id = shader_internal_begin_compile(source, shader_type);
+            if (not shader_internal_end_compile(id, source))
+            {
+                glDeleteShader(id);
+                id = 0;
+            }
+
+            return id;
+        }
+
+        static GLNativeHandle shader_internal_begin_link(GLNativeHandle fragment_id, GLNativeHandle vertex_id)
+        {
+            GLNativeHandle id = glCreateProgram();
+            glAttachShader(id, fragment_id);
+            glAttachShader(id, vertex_id);
+            shader_cache_prepare(id);
+            glLinkProgram(id);
+
+            return id;
+        }
+
+        static bool shader_internal_end_link(GLNativeHandle id)
+        {
+            GLint link_success = GL_FALSE;
+            glGetProgramiv(id, GL_LINK_STATUS, &link_success);
+            if (link_success == GL_TRUE)
+                return true;
+
+            std::stringstream str;
+            str << "In Shader::link_program: linking failed:" << std::endl;
+
+            int info_length = 0;
+            int max_length = info_length;
+
+            glGetProgramiv(id, GL_INFO_LOG_LENGTH, &max_length);
+
+            auto log = std::vector<char>();
+            log.resize(max_length);
+
+            glGetProgramInfoLog(id, max_length, &info_length, log.data());
+
+            for (auto c:log)
+                str << c;
+
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return false;
+        }
+
+        static GLNativeHandle shader_internal_link(GLNativeHandle fragment_id, GLNativeHandle vertex_id)
+        {
+            auto id = shader_internal_begin_link(fragment_id, vertex_id);
+            if (not shader_internal_end_link(id))
+            {
+                glDeleteProgram(id);
+                id = 0;
+            }
+
+            return id;
+        }
+
+        // replace source of one shader, the shader itself is only compiled if the resulting program is not cached
+        static void shader_internal_set_source(ShaderInternal* self, ShaderType type, const std::string& code)
+        {
+            auto*& source = type == ShaderType::FRAGMENT ? self->fragment_source : self->vertex_source;
+            auto& shader_id = type == ShaderType::FRAGMENT ? self->fragment_shader_id : self->vertex_shader_id;
+
+            if (source != nullptr and shader_id != 0)
+                glDeleteShader(shader_id);
+
+            shader_id = 0;
+            delete source;
+            source = new std::string(code);
+        }
+
+        // free programs of the previous source and abort compilation that is still in progress
+        static void shader_internal_release_program(ShaderInternal* self)
+        {
+            if (self->pending_program_id != 0)
+                glDeleteProgram(self->pending_program_id);
+
+            if (self->instanced_program_id != 0 and self->instanced_program_id != self->program_id)
+            {
+                gl_state_forget_program(self->instanced_program_id);
+                glDeleteProgram(self->instanced_program_id);
+            }
+
+            if (self->program_id != 0 and self->program_id != ShaderInternal::noop_program_id)
+            {
+                gl_state_forget_program(self->program_id);
+                glDeleteProgram(self->program_id);
+            }
+
+            self->pending_program_id = 0;
+            self->instanced_program_id = 0;
+            self->program_id = 0;
+            self->compile_stage = ShaderCompileStage::READY;
+
+            // the next program may be given the same name, which would otherwise skip querying its locations
+            self->uniform_cache->program_id = 0;
+            self->instanced_uniform_cache->program_id = 0;
+            SHADER_PROGRAM_VERSION += 1;
+        }
+
+        static void shader_internal_finish(ShaderInternal* self, GLNativeHandle program_id)
+        {
+            self->program_id = program_id;
+            self->compile_stage = ShaderCompileStage::READY;
+            shader_internal_get_uniform_cache(self, self->program_id);
+            self->version = render_state_next_version();
+            SHADER_PROGRAM_VERSION += 1;
+        }
+
+        void shader_internal_advance(ShaderInternal* self)
+        {
+            auto stage = self->compile_stage;
+            if (stage == ShaderCompileStage::READY)
+                return;
+
+            auto& fragment_id = shader_internal_get_shader_id(self, ShaderType::FRAGMENT);
+            auto& vertex_id = shader_internal_get_shader_id(self, ShaderType::VERTEX);
+            const auto& fragment_source = shader_internal_get_source(self, ShaderType::FRAGMENT);
+            const auto& vertex_source = shader_internal_get_source(self, ShaderType::VERTEX);
+
+            if (stage == ShaderCompileStage::COMPILE_FRAGMENT)
+            {
+                if (fragment_id == 0)
+                    fragment_id = shader_internal_compile(fragment_source, ShaderType::FRAGMENT);
+
+                self->compile_stage = ShaderCompileStage::COMPILE_VERTEX;
+            }
+            else if (stage == ShaderCompileStage::COMPILE_VERTEX)
+            {
+                if (vertex_id == 0)
+                    vertex_id = shader_internal_compile(vertex_source, ShaderType::VERTEX);
+
+                self->compile_stage = ShaderCompileStage::LINK;
+            }
+            else if (stage == ShaderCompileStage::LINK)
+            {
+                GLNativeHandle program_id = 0;
+                if (fragment_id != 0 and vertex_id != 0)
+                {
+                    program_id = shader_internal_link(fragment_id, vertex_id);
+                    shader_cache_store(program_id, fragment_source, vertex_source);
+                }
+
+                shader_internal_finish(self, program_id);
+            }
+            else if (stage == ShaderCompileStage::WAIT_FOR_DRIVER)
+            {
+                // GL_COMPLETION_STATUS_ARB has the same value
+                GLint is_done = GL_FALSE;
+                glGetProgramiv(self->pending_program_id, GL_COMPLETION_STATUS_KHR, &is_done);
+                if (is_done != GL_TRUE)
+                    return;
+
+                auto program_id = self->pending_program_id;
+                self->pending_program_id = 0;
+
+                // both are checked, such that errors of both shaders are reported
+                auto fragment_ok = shader_internal_end_compile(fragment_id, fragment_source);
+                auto vertex_ok = shader_internal_end_compile(vertex_id, vertex_source);
+
+                if (not fragment_ok)
+                {
+                    glDeleteShader(fragment_id);
+                    fragment_id = 0;
+                }
+
+                if (not vertex_ok)
+                {
+                    glDeleteShader(vertex_id);
+                    vertex_id = 0;
+                }
+
+                if (fragment_ok and vertex_ok and shader_internal_end_link(program_id))
+                    shader_cache_store(program_id, fragment_source, vertex_source);
+                else
+                {
+                    glDeleteProgram(program_id);
+                    program_id = 0;
+                }
+
+                shader_internal_finish(self, program_id);
+            }
+        }
+
+        bool shader_internal_is_ready(ShaderInternal* self)
+        {
+            return self->compile_stage == ShaderCompileStage::READY and self->program_id != 0;
+        }
     }
 
     Shader::Shader()
@@ -73,14 +416,12 @@ namespace mousetrap
         }
 
         if (ShaderInternal::noop_program_id == 0)
-        {
-            ShaderInternal::noop_fragment_shader_id = compile_shader(noop_fragment_shader_code, ShaderType::FRAGMENT);
-            ShaderInternal::noop_vertex_shader_id = compile_shader(noop_vertex_shader_code, ShaderType::VERTEX);
-            ShaderInternal::noop_program_id = link_program(ShaderInternal::noop_fragment_shader_id, ShaderInternal::noop_vertex_shader_id);
-        }
+            ShaderInternal::noop_program_id = create_program(noop_fragment_shader_code, noop_vertex_shader_code, ShaderInternal::noop_fragment_shader_id, ShaderInternal::noop_vertex_shader_id);
 
         _internal = detail::shader_internal_new();
         g_object_ref(_internal);
+
+        detail::shader_internal_get_uniform_cache(_internal, _internal->program_id);
     }
 
     Shader::Shader(detail::ShaderInternal* internal)
@@ -115,21 +456,106 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return false;
 
-        if (type == ShaderType::FRAGMENT)
-            _internal->fragment_shader_id = compile_shader(code, type);
+        detail::shader_internal_set_source(_internal, type, code);
+        detail::shader_internal_release_program(_internal);
+
+        auto program_id = create_program(
+            detail::shader_internal_get_source(_internal, ShaderType::FRAGMENT),
+            detail::shader_internal_get_source(_internal, ShaderType::VERTEX),
+            detail::shader_internal_get_shader_id(_internal, ShaderType::FRAGMENT),
+            detail::shader_internal_get_shader_id(_internal, ShaderType::VERTEX)
+        );
+
+        detail::shader_internal_finish(_internal, program_id);
+
+        // the program is only linked if both shaders compiled
+        return _internal->program_id != 0;
+    }
+
+    void Shader::create_from_string_async(ShaderType type, const std::string& code)
+    {
+        using namespace detail;
+
+        if (detail::is_opengl_disabled())
+            return;
+
+        shader_internal_set_source(_internal, type, code);
+        shader_internal_release_program(_internal);
+
+        const auto& fragment_source = shader_internal_get_source(_internal, ShaderType::FRAGMENT);
+        const auto& vertex_source = shader_internal_get_source(_internal, ShaderType::VERTEX);
+
+        auto cached_id = shader_cache_load(fragment_source, vertex_source);
+        if (cached_id != 0)
+        {
+            shader_internal_finish(_internal, cached_id);
+            return;
+        }
+
+        if (GLEW_KHR_parallel_shader_compile or GLEW_ARB_parallel_shader_compile)
+        {
+            // let the driver pick the number of threads
+            static bool threads_set = false;
+            if (not threads_set)
+            {
+                if (GLEW_KHR_parallel_shader_compile)
+                    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+                else
+                    glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
+                threads_set = true;
+            }
+
+            auto& fragment_id = shader_internal_get_shader_id(_internal, ShaderType::FRAGMENT);
+            auto& vertex_id = shader_internal_get_shader_id(_internal, ShaderType::VERTEX);
+
+            // the status is not queried until the driver reports completion, which would block
+            if (fragment_id == 0)
+                fragment_id = shader_internal_begin_compile(fragment_source, ShaderType::FRAGMENT);
+
+            if (vertex_id == 0)
+                vertex_id = shader_internal_begin_compile(vertex_source, ShaderType::VERTEX);
+
+            _internal->pending_program_id = shader_internal_begin_link(fragment_id, vertex_id);
+            _internal->compile_stage = ShaderCompileStage::WAIT_FOR_DRIVER;
+        }
         else
-            _internal->vertex_shader_id = compile_shader(code, type);
+            _internal->compile_stage = ShaderCompileStage::COMPILE_FRAGMENT;
 
-        _internal->program_id = link_program(_internal->fragment_shader_id, _internal->vertex_shader_id);
+        _internal->version = render_state_next_version();
+    }
 
-        if (
-        (type == ShaderType::FRAGMENT and _internal->fragment_shader_id == 0) or
-        (type == ShaderType::VERTEX and _internal->vertex_shader_id == 0) or
-        _internal->program_id == 0
-        )
+    bool Shader::create_from_file_async(ShaderType type, const std::string& path)
+    {
+        if (detail::is_opengl_disabled())
             return false;
-        else
-            return true;
+
+        auto file = std::ifstream();
+
+        file.open(path);
+        if (not file.is_open())
+        {
+            log::critical("In Shader::create_from_file_async: Unable to open file at `" + path + "`", MOUSETRAP_DOMAIN);
+            return false;
+        }
+
+        auto str = std::stringstream();
+        str << file.rdbuf();
+
+        create_from_string_async(type, str.str());
+        return true;
+    }
+
+    bool Shader::is_ready() const
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        // only checks whether the driver is done, which does not block
+        if (_internal->compile_stage == detail::ShaderCompileStage::WAIT_FOR_DRIVER)
+            detail::shader_internal_advance(_internal);
+
+        return detail::shader_internal_is_ready(_internal);
     }
 
     bool Shader::create_from_file(ShaderType type, const std::string& path)
@@ -172,7 +598,11 @@ namespace mousetrap
         if (not detail::MOUSETRAP_IS_SHADER_INTERNAL(_internal))
             return -1;
 
-        return _internal->vertex_shader_id;
+        auto& id = detail::shader_internal_get_shader_id(_internal, ShaderType::VERTEX);
+        if (id == 0)
+            id = compile_shader(detail::shader_internal_get_source(_internal, ShaderType::VERTEX), ShaderType::VERTEX);
+
+        return id;
     }
 
     GLNativeHandle Shader::get_fragment_shader_id() const
@@ -183,86 +613,78 @@ namespace mousetrap
         if (not detail::MOUSETRAP_IS_SHADER_INTERNAL(_internal))
             return -1;
 
-        return _internal->fragment_shader_id;
+        auto& id = detail::shader_internal_get_shader_id(_internal, ShaderType::FRAGMENT);
+        if (id == 0)
+            id = compile_shader(detail::shader_internal_get_source(_internal, ShaderType::FRAGMENT), ShaderType::FRAGMENT);
+
+        return id;
     }
 
-    GLNativeHandle Shader::compile_shader(const std::string& source, ShaderType shader_type)
+    GLNativeHandle Shader::get_instanced_program_id() const
     {
+        using namespace detail;
+
         if (detail::is_opengl_disabled())
-            return 0;
+            return -1;
 
-        GLNativeHandle id = glCreateShader(static_cast<GLenum>(shader_type));
+        if (not detail::MOUSETRAP_IS_SHADER_INTERNAL(_internal))
+            return -1;
 
-        const char* source_ptr = source.c_str();
-        glShaderSource(id, 1, &source_ptr, nullptr);
-        glCompileShader(id);
+        // custom vertex shaders are responsible for reading the instance attributes themself
+        if (_internal->vertex_source != nullptr)
+            return _internal->program_id;
 
-        GLint compilation_success = GL_FALSE;
-        glGetShaderiv(id, GL_COMPILE_STATUS, &compilation_success);
-        if (compilation_success != GL_TRUE)
+        if (_internal->instanced_program_id == 0)
         {
-            std::stringstream str;
-            str << "In Shader::compile_shader: compilation failed:\n"
-                << source << "\n\n";
-
-            int info_length = 0;
-            int max_length = info_length;
-
-            glGetShaderiv(id, GL_INFO_LOG_LENGTH, &max_length);
-
-            auto log = std::vector<char>();
-            log.resize(max_length);
-
-            glGetShaderInfoLog(id, max_length, &info_length, log.data());
-
-            for (auto c:log)
-                str << c;
-
-            log::critical(str.str(), MOUSETRAP_DOMAIN);
-
-            glDeleteShader(id);
-            id = 0;
+            _internal->instanced_program_id = create_program(
+                detail::shader_internal_get_source(_internal, ShaderType::FRAGMENT),
+                noop_instanced_vertex_shader_code,
+                detail::shader_internal_get_shader_id(_internal, ShaderType::FRAGMENT),
+                ShaderInternal::noop_instanced_vertex_shader_id
+            );
         }
 
-        return id;
+        return _internal->instanced_program_id;
     }
 
-    GLNativeHandle Shader::link_program(GLNativeHandle fragment_id, GLNativeHandle vertex_id)
+    GLNativeHandle Shader::compile_shader(const std::string& source, ShaderType shader_type) const
     {
         if (detail::is_opengl_disabled())
             return 0;
 
-        GLNativeHandle id = glCreateProgram();
-        glAttachShader(id, fragment_id);
-        glAttachShader(id, vertex_id);
-        glLinkProgram(id);
-
-        GLint link_success = GL_FALSE;
-        glGetProgramiv(id, GL_LINK_STATUS, &link_success);
-        if (link_success != GL_TRUE)
-        {
-            std::stringstream str;
-            str << "In Shader::link_program: linking failed:" << std::endl;
+        return detail::shader_internal_compile(source, shader_type);
+    }
 
-            int info_length = 0;
-            int max_length = info_length;
+    GLNativeHandle Shader::link_program(GLNativeHandle fragment_id, GLNativeHandle vertex_id) const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
 
-            glGetProgramiv(_internal->program_id, GL_INFO_LOG_LENGTH, &max_length);
+        return detail::shader_internal_link(fragment_id, vertex_id);
+    }
 
-            auto log = std::vector<char>();
-            log.resize(max_length);
+    GLNativeHandle Shader::create_program(const std::string& fragment_source, const std::string& vertex_source, GLNativeHandle& fragment_id, GLNativeHandle& vertex_id) const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
 
-            glGetProgramInfoLog(_internal->program_id, max_length, &info_length, log.data());
+        // a cached binary skips both compiling and linking, the shaders are only compiled if requested later
+        auto id = detail::shader_cache_load(fragment_source, vertex_source);
+        if (id != 0)
+            return id;
 
-            for (auto c:log)
-                str << c;
+        if (fragment_id == 0)
+            fragment_id = compile_shader(fragment_source, ShaderType::FRAGMENT);
 
-            log::critical(str.str(), MOUSETRAP_DOMAIN);
+        if (vertex_id == 0)
+            vertex_id = compile_shader(vertex_source, ShaderType::VERTEX);
 
-            glDeleteProgram(id);
-            id = 0;
-        }
+        // compilation errors were already reported
+        if (fragment_id == 0 or vertex_id == 0)
+            return 0;
 
+        id = link_program(fragment_id, vertex_id);
+        detail::shader_cache_store(id, fragment_source, vertex_source);
         return id;
     }
 
@@ -271,7 +693,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glUseProgram(get_program_id());
+        detail::gl_state_use_program(get_program_id());
         glUniform1f(get_uniform_location(uniform_name), value);
     }
 
@@ -280,7 +702,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glUseProgram(get_program_id());
+        detail::gl_state_use_program(get_program_id());
         glUniform1i(get_uniform_location(uniform_name), value);
     }
 
@@ -289,7 +711,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glUseProgram(get_program_id());
+        detail::gl_state_use_program(get_program_id());
         glUniform1ui(get_uniform_location(uniform_name), value);
     }
 
@@ -298,7 +720,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glUseProgram(get_program_id());
+        detail::gl_state_use_program(get_program_id());
         glUniform2f(get_uniform_location(uniform_name), value.x, value.y);
     }
 
@@ -307,7 +729,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glUseProgram(get_program_id());
+        detail::gl_state_use_program(get_program_id());
         glUniform3f(get_uniform_location(uniform_name), value.x, value.y, value.z);
     }
 
@@ -316,7 +738,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glUseProgram(get_program_id());
+        detail::gl_state_use_program(get_program_id());
         glUniform4f(get_uniform_location(uniform_name), value.x, value.y, value.z, value.w);
     }
 
@@ -325,7 +747,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glUseProgram(get_program_id());
+        detail::gl_state_use_program(get_program_id());
         glUniformMatrix4fv(get_uniform_location(uniform_name), 1, false, &value.transform[0][0]);
     }
 
@@ -334,8 +756,7 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return 0;
 
-        glUseProgram(get_program_id());
-        return glGetUniformLocation(_internal->program_id, str.c_str());
+        return detail::shader_internal_get_uniform_location(_internal, _internal->program_id, str);
     }
 
     int Shader::get_vertex_position_location()
@@ -353,6 +774,21 @@ namespace mousetrap
         return 2;
     }
 
+    int Shader::get_instance_transform_location()
+    {
+        return 3;
+    }
+
+    int Shader::get_instance_color_location()
+    {
+        return 7;
+    }
+
+    int Shader::get_instance_texture_rectangle_location()
+    {
+        return 8;
+    }
+
     Shader::operator NativeObject() const
     {
         if (detail::is_opengl_disabled())
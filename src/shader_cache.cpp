@@ -0,0 +1,273 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/shader_cache.hpp>
+#include <mousetrap/shader.hpp>
+#include <mousetrap/log.hpp>
+
+#include <glib/gstdio.h>
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        static bool SHADER_CACHE_ENABLED = true;
+        static std::string* SHADER_CACHE_DIRECTORY = nullptr;
+        static int SHADER_CACHE_AVAILABLE = -1;
+
+        // bump whenever the file layout changes, such that old files are never read
+        static constexpr uint32_t SHADER_CACHE_FORMAT_VERSION = 1;
+        static constexpr uint32_t SHADER_CACHE_MAGIC = 0x4d545042; // MTPB
+
+        struct ShaderCacheHeader
+        {
+            uint32_t magic;
+            uint32_t binary_format;
+            uint64_t checksum;
+        };
+
+        // FNV-1a, unlike std::hash it is stable across standard libraries and runs, which an on-disk key needs to be
+        static uint64_t shader_cache_hash(const std::string& data, uint64_t seed)
+        {
+            uint64_t out = seed;
+            for (unsigned char c : data)
+            {
+                out ^= c;
+                out *= 0x100000001b3;
+            }
+            return out;
+        }
+
+        static std::string& shader_cache_get_directory()
+        {
+            if (SHADER_CACHE_DIRECTORY == nullptr)
+            {
+                auto* path = g_build_filename(g_get_user_cache_dir(), "mousetrap", "shader_cache", nullptr);
+                SHADER_CACHE_DIRECTORY = new std::string(path);
+                g_free(path);
+            }
+
+            return *SHADER_CACHE_DIRECTORY;
+        }
+
+        // a binary is only valid for the exact driver that produced it, which also changes whenever the driver is updated
+        static const std::string& shader_cache_get_driver()
+        {
+            static std::string* driver = nullptr;
+            if (driver == nullptr)
+            {
+                auto get = [](GLenum name) -> std::string {
+                    auto* str = (const char*) glGetString(name);
+                    return str != nullptr ? str : "";
+                };
+
+                driver = new std::string(get(GL_VENDOR) + '\n' + get(GL_RENDERER) + '\n' + get(GL_VERSION) + '\n' + get(GL_SHADING_LANGUAGE_VERSION));
+            }
+
+            return *driver;
+        }
+
+        static std::string shader_cache_get_key(const std::string& fragment_source, const std::string& vertex_source)
+        {
+            std::stringstream str;
+            str << SHADER_CACHE_FORMAT_VERSION << '\n'
+                << shader_cache_get_driver() << '\n'
+                << Shader::get_vertex_position_location() << ' '
+                << Shader::get_vertex_color_location() << ' '
+                << Shader::get_vertex_texture_coordinate_location() << ' '
+                << Shader::get_instance_transform_location() << ' '
+                << Shader::get_instance_color_location() << ' '
+                << Shader::get_instance_texture_rectangle_location() << '\n'
+                << fragment_source.size() << '\n' << fragment_source << '\n'
+                << vertex_source.size() << '\n' << vertex_source;
+
+            return str.str();
+        }
+
+        static constexpr uint64_t SHADER_CACHE_NAME_SEED = 0xcbf29ce484222325;
+        static constexpr uint64_t SHADER_CACHE_CHECKSUM_SEED = 0x84222325cbf29ce4;
+
+        static std::string shader_cache_get_path(const std::string& key)
+        {
+            std::stringstream name;
+            name << std::hex << std::setw(16) << std::setfill('0') << shader_cache_hash(key, SHADER_CACHE_NAME_SEED) << ".bin";
+
+            auto* path = g_build_filename(shader_cache_get_directory().c_str(), name.str().c_str(), nullptr);
+            auto out = std::string(path);
+            g_free(path);
+            return out;
+        }
+
+        bool shader_cache_is_available()
+        {
+            if (SHADER_CACHE_AVAILABLE < 0)
+            {
+                GLint n_formats = 0;
+                if (GLEW_VERSION_4_1 or GLEW_ARB_get_program_binary)
+                    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+
+                SHADER_CACHE_AVAILABLE = n_formats > 0 ? 1 : 0;
+            }
+
+            return SHADER_CACHE_AVAILABLE == 1;
+        }
+
+        GLNativeHandle shader_cache_load(const std::string& fragment_source, const std::string& vertex_source)
+        {
+            if (not SHADER_CACHE_ENABLED or not shader_cache_is_available())
+                return 0;
+
+            auto key = shader_cache_get_key(fragment_source, vertex_source);
+
+            gchar* contents = nullptr;
+            gsize length = 0;
+            if (not g_file_get_contents(shader_cache_get_path(key).c_str(), &contents, &length, nullptr))
+                return 0;
+
+            // the file name is a hash, the checksum guards against two keys colliding
+            ShaderCacheHeader header;
+            if (length <= sizeof(ShaderCacheHeader))
+            {
+                g_free(contents);
+                return 0;
+            }
+
+            std::memcpy(&header, contents, sizeof(ShaderCacheHeader));
+            if (header.magic != SHADER_CACHE_MAGIC or header.checksum != shader_cache_hash(key, SHADER_CACHE_CHECKSUM_SEED))
+            {
+                g_free(contents);
+                return 0;
+            }
+
+            GLNativeHandle id = glCreateProgram();
+            glProgramBinary(id, header.binary_format, contents + sizeof(ShaderCacheHeader), length - sizeof(ShaderCacheHeader));
+            g_free(contents);
+
+            // drivers may reject binaries for reasons not covered by the key, the caller then compiles from source, which overwrites the file
+            GLint link_success = GL_FALSE;
+            glGetProgramiv(id, GL_LINK_STATUS, &link_success);
+            if (link_success != GL_TRUE)
+            {
+                glDeleteProgram(id);
+                return 0;
+            }
+
+            return id;
+        }
+
+        void shader_cache_prepare(GLNativeHandle program_id)
+        {
+            if (not SHADER_CACHE_ENABLED or not shader_cache_is_available())
+                return;
+
+            glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        void shader_cache_store(GLNativeHandle program_id, const std::string& fragment_source, const std::string& vertex_source)
+        {
+            if (not SHADER_CACHE_ENABLED or not shader_cache_is_available() or program_id == 0)
+                return;
+
+            GLint binary_length = 0;
+            glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+            if (binary_length <= 0)
+                return;
+
+            auto key = shader_cache_get_key(fragment_source, vertex_source);
+
+            auto data = std::vector<char>(sizeof(ShaderCacheHeader) + binary_length);
+            ShaderCacheHeader header;
+            header.magic = SHADER_CACHE_MAGIC;
+            header.checksum = shader_cache_hash(key, SHADER_CACHE_CHECKSUM_SEED);
+
+            GLenum binary_format = 0;
+            glGetProgramBinary(program_id, binary_length, nullptr, &binary_format, data.data() + sizeof(ShaderCacheHeader));
+            header.binary_format = binary_format;
+            std::memcpy(data.data(), &header, sizeof(ShaderCacheHeader));
+
+            if (g_mkdir_with_parents(shader_cache_get_directory().c_str(), 0755) != 0)
+            {
+                log::warning("In shader_cache_store: Unable to create cache directory at `" + shader_cache_get_directory() + "`", MOUSETRAP_DOMAIN);
+                return;
+            }
+
+            // written to a temporary file first, such that a crash never leaves a truncated binary behind
+            GError* error = nullptr;
+            auto path = shader_cache_get_path(key);
+            if (not g_file_set_contents(path.c_str(), data.data(), data.size(), &error))
+            {
+                log::warning("In shader_cache_store: Unable to write program binary to `" + path + "`: " + error->message, MOUSETRAP_DOMAIN);
+                g_error_free(error);
+            }
+        }
+    }
+
+    void ShaderCache::set_enabled(bool b)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::SHADER_CACHE_ENABLED = b;
+    }
+
+    bool ShaderCache::get_enabled()
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        return detail::SHADER_CACHE_ENABLED and detail::shader_cache_is_available();
+    }
+
+    void ShaderCache::set_directory(const std::string& path)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::shader_cache_get_directory() = path;
+    }
+
+    std::string ShaderCache::get_directory()
+    {
+        if (detail::is_opengl_disabled())
+            return "";
+
+        return detail::shader_cache_get_directory();
+    }
+
+    void ShaderCache::clear()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto& directory = detail::shader_cache_get_directory();
+        auto* dir = g_dir_open(directory.c_str(), 0, nullptr);
+        if (dir == nullptr)
+            return;
+
+        // only remove files the cache wrote, in case the directory is shared
+        static const std::string suffix = ".bin";
+        while (auto* name = g_dir_read_name(dir))
+        {
+            auto file = std::string(name);
+            if (file.size() != 16 + suffix.size() or file.compare(16, suffix.size(), suffix) != 0)
+                continue;
+
+            auto* path = g_build_filename(directory.c_str(), name, nullptr);
+            g_remove(path);
+            g_free(path);
+        }
+
+        g_dir_close(dir);
+    }
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
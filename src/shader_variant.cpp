@@ -0,0 +1,185 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/shader_variant.hpp>
+#include <mousetrap/log.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        // keyed by both sources and the sorted defines, such that variants with the same source share their permutations
+        static std::unordered_map<std::string, Shader*>* SHADER_VARIANT_CACHE = nullptr;
+
+        // incremented by ShaderVariant::clear_cache, invalidates the permutations memoized by each variant
+        static uint64_t SHADER_VARIANT_CACHE_GENERATION = 0;
+
+        std::string shader_variant_inject_defines(const std::string& source, const std::vector<std::string>& defines)
+        {
+            if (defines.empty())
+                return source;
+
+            uint64_t insert_at = 0;
+            auto version = source.find("#version");
+            if (version != std::string::npos)
+            {
+                auto line_end = source.find('\n', version);
+                insert_at = line_end == std::string::npos ? source.size() : line_end + 1;
+            }
+
+            std::stringstream str;
+            str << source.substr(0, insert_at);
+
+            if (insert_at > 0 and source.at(insert_at - 1) != '\n')
+                str << '\n';
+
+            for (auto& define : defines)
+                str << "#define " << define << " 1\n";
+
+            // the next line of the original source is line n + 1 if n newlines precede it
+            str << "#line " << std::count(source.begin(), source.begin() + insert_at, '\n') + 1 << "\n";
+            str << source.substr(insert_at);
+            return str.str();
+        }
+    }
+
+    ShaderVariant::ShaderVariant()
+        : _fragment_source(default_fragment_shader_code),
+          _vertex_source(""),
+          _defines(),
+          _permutations(),
+          _permutations_generation(0)
+    {}
+
+    void ShaderVariant::create_from_string(ShaderType type, const std::string& code)
+    {
+        if (type == ShaderType::FRAGMENT)
+            _fragment_source = code;
+        else
+            _vertex_source = code;
+
+        _permutations.clear();
+    }
+
+    bool ShaderVariant::create_from_file(ShaderType type, const std::string& path)
+    {
+        auto file = std::ifstream();
+
+        file.open(path);
+        if (not file.is_open())
+        {
+            log::critical("In ShaderVariant::create_from_file: Unable to open file at `" + path + "`", MOUSETRAP_DOMAIN);
+            return false;
+        }
+
+        auto str = std::stringstream();
+        str << file.rdbuf();
+
+        create_from_string(type, str.str());
+        return true;
+    }
+
+    uint64_t ShaderVariant::add_define(const std::string& name)
+    {
+        auto it = std::find(_defines.begin(), _defines.end(), name);
+        if (it != _defines.end())
+            return uint64_t(1) << (it - _defines.begin());
+
+        if (_defines.size() >= 64)
+        {
+            log::critical("In ShaderVariant::add_define: Unable to add define `" + name + "`, at most 64 defines can be registered", MOUSETRAP_DOMAIN);
+            return 0;
+        }
+
+        _defines.push_back(name);
+        return uint64_t(1) << (_defines.size() - 1);
+    }
+
+    const std::vector<std::string>& ShaderVariant::get_defines() const
+    {
+        return _defines;
+    }
+
+    const Shader& ShaderVariant::get_shader(uint64_t flags) const
+    {
+        if (detail::is_opengl_disabled())
+        {
+            static auto* disabled = new Shader();
+            return *disabled;
+        }
+
+        if (_permutations_generation != detail::SHADER_VARIANT_CACHE_GENERATION)
+        {
+            _permutations.clear();
+            _permutations_generation = detail::SHADER_VARIANT_CACHE_GENERATION;
+        }
+
+        // flags of registered defines never change, so the permutation for the same flags stays the same
+        auto memoized = _permutations.find(flags);
+        if (memoized != _permutations.end())
+            return *memoized->second;
+
+        auto defines = std::vector<std::string>();
+        for (uint64_t i = 0; i < _defines.size(); ++i)
+            if (flags & (uint64_t(1) << i))
+                defines.push_back(_defines.at(i));
+
+        // the order defines were registered in does not change the permutation
+        std::sort(defines.begin(), defines.end());
+
+        std::stringstream key;
+        key << _fragment_source.size() << '\n' << _fragment_source << '\n'
+            << _vertex_source.size() << '\n' << _vertex_source << '\n';
+
+        for (auto& define : defines)
+            key << define << '\n';
+
+        if (detail::SHADER_VARIANT_CACHE == nullptr)
+            detail::SHADER_VARIANT_CACHE = new std::unordered_map<std::string, Shader*>();
+
+        auto& cache = *detail::SHADER_VARIANT_CACHE;
+        auto it = cache.find(key.str());
+        if (it != cache.end())
+        {
+            _permutations.insert({flags, it->second});
+            return *it->second;
+        }
+
+        // an empty vertex source keeps the default vertex shader, which also keeps instancing and culling available
+        auto* shader = new Shader();
+        shader->create_from_string(ShaderType::FRAGMENT, detail::shader_variant_inject_defines(_fragment_source, defines));
+
+        if (not _vertex_source.empty())
+            shader->create_from_string(ShaderType::VERTEX, detail::shader_variant_inject_defines(_vertex_source, defines));
+
+        cache.insert({key.str(), shader});
+        _permutations.insert({flags, shader});
+        return *shader;
+    }
+
+    void ShaderVariant::clear_cache()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        if (detail::SHADER_VARIANT_CACHE == nullptr)
+            return;
+
+        for (auto& pair : *detail::SHADER_VARIANT_CACHE)
+            delete pair.second;
+
+        detail::SHADER_VARIANT_CACHE->clear();
+        detail::SHADER_VARIANT_CACHE_GENERATION += 1;
+    }
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
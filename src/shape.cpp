@@ -29,20 +29,175 @@ namespace mousetrap
                 return;
 
             if (self->vertex_array_id != 0)
+            {
+                detail::gl_state_forget_vertex_array(self->vertex_array_id);
                 glDeleteVertexArrays(1, &self->vertex_array_id);
+            }
 
             if (self->vertex_buffer_id != 0)
                 glDeleteBuffers(1, &self->vertex_buffer_id);
 
+            if (self->element_buffer_id != 0)
+                glDeleteBuffers(1, &self->element_buffer_id);
+
             delete self->color;
-            delete self->vertices;
             delete self->indices;
             delete self->vertex_data;
+            delete self->compact_vertex_data;
+            delete self->dirty_ranges;
+            delete self->indexing_areas;
         }
 
         DEFINE_NEW_TYPE_TRIVIAL_INIT(ShapeInternal, shape_internal, SHAPE_INTERNAL)
         DEFINE_NEW_TYPE_TRIVIAL_CLASS_INIT(ShapeInternal, shape_internal, SHAPE_INTERNAL)
 
+        // record the per-vertex attributes of the shapes vertex format in the vertex array, has to happen again whenever the format changes
+        static void shape_internal_bind_vertex_format(ShapeInternal* self)
+        {
+            detail::gl_state_bind_vertex_array(self->vertex_array_id);
+            glBindBuffer(GL_ARRAY_BUFFER, self->vertex_buffer_id);
+
+            auto position_location = Shader::get_vertex_position_location();
+            auto color_location = Shader::get_vertex_color_location();
+            auto texture_coordinate_location = Shader::get_vertex_texture_coordinate_location();
+
+            glEnableVertexAttribArray(position_location);
+            glEnableVertexAttribArray(color_location);
+            glEnableVertexAttribArray(texture_coordinate_location);
+
+            if (self->vertex_format == VertexFormat::COMPACT)
+            {
+                // z of the vec3 shader input defaults to 0 for a 2-component attribute
+                glVertexAttribPointer(position_location,
+                                      2,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct detail::CompactVertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct detail::CompactVertexInfo, _position))
+                );
+
+                glVertexAttribPointer(color_location,
+                                      4,
+                                      GL_UNSIGNED_BYTE,
+                                      GL_TRUE,
+                                      sizeof(struct detail::CompactVertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct detail::CompactVertexInfo, _color))
+                );
+
+                glVertexAttribPointer(texture_coordinate_location,
+                                      2,
+                                      GL_HALF_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct detail::CompactVertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct detail::CompactVertexInfo, _texture_coordinates))
+                );
+            }
+            else
+            {
+                glVertexAttribPointer(position_location,
+                                      3,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct detail::VertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct detail::VertexInfo, _position))
+                );
+
+                glVertexAttribPointer(color_location,
+                                      4,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct detail::VertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct detail::VertexInfo, _color))
+                );
+
+                glVertexAttribPointer(texture_coordinate_location,
+                                      2,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct detail::VertexInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct detail::VertexInfo, _texture_coordinates))
+                );
+            }
+
+            detail::gl_state_bind_vertex_array(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        // allocate buffers and record the attribute layout and element buffer in the vertex array, this only needs to happen once per shape
+        static void shape_internal_create_vertex_array(ShapeInternal* self)
+        {
+            glGenVertexArrays(1, &self->vertex_array_id);
+            glGenBuffers(1, &self->vertex_buffer_id);
+            glGenBuffers(1, &self->element_buffer_id);
+
+            detail::gl_state_bind_vertex_array(self->vertex_array_id);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->element_buffer_id);
+            detail::gl_state_bind_vertex_array(0);
+
+            shape_internal_bind_vertex_format(self);
+        }
+
+        // record the per-instance attributes of an instance buffer in the vertex array, or disable them if buffer_id is 0
+        static void shape_internal_bind_instance_buffer(ShapeInternal* self, GLNativeHandle buffer_id)
+        {
+            detail::gl_state_bind_vertex_array(self->vertex_array_id);
+
+            auto transform_location = Shader::get_instance_transform_location();
+            auto color_location = Shader::get_instance_color_location();
+            auto texture_rectangle_location = Shader::get_instance_texture_rectangle_location();
+
+            if (buffer_id != 0)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, buffer_id);
+
+                // a mat4 attribute occupies 4 consecutive locations, one per column
+                for (uint64_t i = 0; i < 4; ++i)
+                {
+                    glEnableVertexAttribArray(transform_location + i);
+                    glVertexAttribPointer(transform_location + i,
+                                          4,
+                                          GL_FLOAT,
+                                          GL_FALSE,
+                                          sizeof(struct detail::InstanceInfo),
+                                          (GLvoid *) (G_STRUCT_OFFSET(struct detail::InstanceInfo, _transform) + i * 4 * sizeof(float))
+                    );
+                    glVertexAttribDivisor(transform_location + i, 1);
+                }
+
+                glEnableVertexAttribArray(color_location);
+                glVertexAttribPointer(color_location,
+                                      4,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct detail::InstanceInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct detail::InstanceInfo, _color))
+                );
+                glVertexAttribDivisor(color_location, 1);
+
+                glEnableVertexAttribArray(texture_rectangle_location);
+                glVertexAttribPointer(texture_rectangle_location,
+                                      4,
+                                      GL_FLOAT,
+                                      GL_FALSE,
+                                      sizeof(struct detail::InstanceInfo),
+                                      (GLvoid *) (G_STRUCT_OFFSET(struct detail::InstanceInfo, _texture_rectangle))
+                );
+                glVertexAttribDivisor(texture_rectangle_location, 1);
+
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+            else
+            {
+                for (uint64_t i = 0; i < 4; ++i)
+                    glDisableVertexAttribArray(transform_location + i);
+
+                glDisableVertexAttribArray(color_location);
+                glDisableVertexAttribArray(texture_rectangle_location);
+            }
+
+            self->bound_instance_buffer_id = buffer_id;
+        }
+
         static ShapeInternal* shape_internal_new()
         {
             auto* self = (ShapeInternal*) g_object_new(shape_internal_get_type(), nullptr);
@@ -54,22 +209,260 @@ namespace mousetrap
                 return self;
             }
 
-            gdk_gl_context_make_current(detail::GL_CONTEXT);
+            detail::make_opengl_context_current();
 
-            glGenVertexArrays(1, &self->vertex_array_id);
-            glGenBuffers(1, &self->vertex_buffer_id);
+            self->vertex_format = VertexFormat::FULL;
+            shape_internal_create_vertex_array(self);
 
             self->color = new RGBA(1, 1, 1, 1);
             self->is_visible = true;
             self->render_type = GL_TRIANGLE_STRIP;
+            self->index_type = GL_UNSIGNED_INT;
+            self->n_indices = 0;
 
-            self->vertices = new std::vector<Vertex>();
             self->indices = new std::vector<int>();
             self->vertex_data = new std::vector<VertexInfo>();
+            self->compact_vertex_data = new std::vector<CompactVertexInfo>();
+            self->dirty_ranges = new std::vector<std::pair<uint64_t, uint64_t>>();
+            self->indexing_areas = new std::unordered_map<_RenderAreaInternal*, uint64_t>();
             self->texture = nullptr;
+            self->version = render_state_next_version();
+
+            // forces computation on first access
+            self->bounds_version = std::numeric_limits<uint64_t>::max();
 
             return self;
         }
+
+        // positions are stored in gl coordinates, such that vertex_data can be uploaded as is
+        static void shape_internal_set_vertex_position(VertexInfo& data, Vector3f position)
+        {
+            auto as_gl_position = to_gl_position(position);
+
+            data._position[0] = as_gl_position[0];
+            data._position[1] = as_gl_position[1];
+            data._position[2] = as_gl_position[2];
+        }
+
+        static void shape_internal_set_vertex_position(CompactVertexInfo& data, Vector3f position)
+        {
+            auto as_gl_position = to_gl_position(position);
+
+            data._position[0] = as_gl_position[0];
+            data._position[1] = as_gl_position[1];
+        }
+
+        static Vector3f shape_internal_get_vertex_position(const VertexInfo& data)
+        {
+            return from_gl_position(Vector3f(data._position[0], data._position[1], data._position[2]));
+        }
+
+        static Vector3f shape_internal_get_vertex_position(const CompactVertexInfo& data)
+        {
+            return from_gl_position(Vector3f(data._position[0], data._position[1], 0));
+        }
+
+        static void shape_internal_set_vertex_color(VertexInfo& data, RGBA color)
+        {
+            data._color[0] = color.r;
+            data._color[1] = color.g;
+            data._color[2] = color.b;
+            data._color[3] = color.a;
+        }
+
+        static void shape_internal_set_vertex_color(CompactVertexInfo& data, RGBA color)
+        {
+            auto to_unorm = [](float x) -> uint8_t {
+                return std::round(glm::clamp(x, 0.f, 1.f) * 255.f);
+            };
+
+            data._color[0] = to_unorm(color.r);
+            data._color[1] = to_unorm(color.g);
+            data._color[2] = to_unorm(color.b);
+            data._color[3] = to_unorm(color.a);
+        }
+
+        static RGBA shape_internal_get_vertex_color(const VertexInfo& data)
+        {
+            return RGBA(data._color[0], data._color[1], data._color[2], data._color[3]);
+        }
+
+        static RGBA shape_internal_get_vertex_color(const CompactVertexInfo& data)
+        {
+            return RGBA(data._color[0] / 255.f, data._color[1] / 255.f, data._color[2] / 255.f, data._color[3] / 255.f);
+        }
+
+        static void shape_internal_set_vertex_texture_coordinate(VertexInfo& data, Vector2f coordinates)
+        {
+            data._texture_coordinates[0] = coordinates.x;
+            data._texture_coordinates[1] = coordinates.y;
+        }
+
+        static void shape_internal_set_vertex_texture_coordinate(CompactVertexInfo& data, Vector2f coordinates)
+        {
+            // x is stored in the lower 16 bits
+            auto packed = glm::packHalf2x16(coordinates);
+            data._texture_coordinates[0] = packed & 0xFFFF;
+            data._texture_coordinates[1] = packed >> 16;
+        }
+
+        static Vector2f shape_internal_get_vertex_texture_coordinate(const VertexInfo& data)
+        {
+            return Vector2f(data._texture_coordinates[0], data._texture_coordinates[1]);
+        }
+
+        static Vector2f shape_internal_get_vertex_texture_coordinate(const CompactVertexInfo& data)
+        {
+            return glm::unpackHalf2x16(glm::uint(data._texture_coordinates[0]) | (glm::uint(data._texture_coordinates[1]) << 16));
+        }
+
+        // invoke f with the i-th vertex in whichever format the shape is in
+        template<typename Function_t>
+        static auto shape_internal_visit_vertex(ShapeInternal* self, uint64_t i, Function_t f)
+        {
+            if (self->vertex_format == VertexFormat::COMPACT)
+                return f(self->compact_vertex_data->at(i));
+            else
+                return f(self->vertex_data->at(i));
+        }
+
+        template<typename Function_t>
+        static void shape_internal_visit_vertices(ShapeInternal* self, Function_t f)
+        {
+            if (self->vertex_format == VertexFormat::COMPACT)
+            {
+                for (auto& data : *self->compact_vertex_data)
+                    f(data);
+            }
+            else
+            {
+                for (auto& data : *self->vertex_data)
+                    f(data);
+            }
+        }
+
+        uint64_t shape_internal_get_n_vertices(ShapeInternal* self)
+        {
+            if (self->vertex_format == VertexFormat::COMPACT)
+                return self->compact_vertex_data->size();
+            else
+                return self->vertex_data->size();
+        }
+
+        static uint64_t shape_internal_get_vertex_stride(ShapeInternal* self)
+        {
+            if (self->vertex_format == VertexFormat::COMPACT)
+                return sizeof(struct detail::CompactVertexInfo);
+            else
+                return sizeof(struct detail::VertexInfo);
+        }
+
+        static const char* shape_internal_get_vertex_buffer(ShapeInternal* self)
+        {
+            if (self->vertex_format == VertexFormat::COMPACT)
+                return (const char*) self->compact_vertex_data->data();
+            else
+                return (const char*) self->vertex_data->data();
+        }
+
+        void shape_internal_append_vertex_data(ShapeInternal* self, std::vector<VertexInfo>& out)
+        {
+            if (self->vertex_format != VertexFormat::COMPACT)
+            {
+                out.insert(out.end(), self->vertex_data->begin(), self->vertex_data->end());
+                return;
+            }
+
+            out.reserve(out.size() + self->compact_vertex_data->size());
+            for (auto& in : *self->compact_vertex_data)
+            {
+                auto& data = out.emplace_back();
+                data._position[0] = in._position[0];
+                data._position[1] = in._position[1];
+                data._position[2] = 0;
+                shape_internal_set_vertex_color(data, shape_internal_get_vertex_color(in));
+                shape_internal_set_vertex_texture_coordinate(data, shape_internal_get_vertex_texture_coordinate(in));
+            }
+        }
+
+        // discard old geometry and reserve space for the new one, such that filling it never reallocates
+        static void shape_internal_reset(ShapeInternal* self, uint64_t n_vertices, uint64_t n_indices)
+        {
+            self->vertex_data->clear();
+            self->compact_vertex_data->clear();
+
+            if (self->vertex_format == VertexFormat::COMPACT)
+                self->compact_vertex_data->reserve(n_vertices);
+            else
+                self->vertex_data->reserve(n_vertices);
+
+            self->indices->clear();
+            self->indices->reserve(n_indices);
+        }
+
+        // append vertex in the shapes color, written in place instead of being converted from a mousetrap::Vertex
+        static void shape_internal_push_vertex(ShapeInternal* self, float x, float y)
+        {
+            auto push = [&](auto& data) {
+                shape_internal_set_vertex_position(data, Vector3f(x, y, 0));
+                shape_internal_set_vertex_color(data, *self->color);
+                shape_internal_set_vertex_texture_coordinate(data, Vector2f(0, 0));
+            };
+
+            if (self->vertex_format == VertexFormat::COMPACT)
+                push(self->compact_vertex_data->emplace_back());
+            else
+                push(self->vertex_data->emplace_back());
+        }
+
+        void shape_internal_geometry_changed(ShapeInternal* self)
+        {
+            self->geometry_version += 1;
+
+            for (auto& pair : *self->indexing_areas)
+                render_area_internal_shape_moved(pair.first, self);
+        }
+
+        uint64_t shape_internal_get_version(ShapeInternal* self)
+        {
+            auto out = self->version;
+
+            if (self->instance_buffer != nullptr)
+                out = std::max(out, ((InstanceBufferInternal*) self->instance_buffer->get_internal())->version);
+
+            if (self->texture != nullptr)
+                out = std::max(out, self->texture->get_version());
+
+            return out;
+        }
+
+        void shape_internal_get_bounds(ShapeInternal* self, Vector3f& min, Vector3f& max)
+        {
+            if (self->bounds_version != self->geometry_version)
+            {
+                if (shape_internal_get_n_vertices(self) == 0)
+                {
+                    self->bounds_min = Vector3f(0);
+                    self->bounds_max = Vector3f(0);
+                }
+                else
+                {
+                    self->bounds_min = Vector3f(std::numeric_limits<float>::max());
+                    self->bounds_max = Vector3f(std::numeric_limits<float>::lowest());
+
+                    shape_internal_visit_vertices(self, [&](auto& data) {
+                        auto position = shape_internal_get_vertex_position(data);
+                        self->bounds_min = glm::min(self->bounds_min, position);
+                        self->bounds_max = glm::max(self->bounds_max, position);
+                    });
+                }
+
+                self->bounds_version = self->geometry_version;
+            }
+
+            min = self->bounds_min;
+            max = self->bounds_max;
+        }
     }
     
     Shape::Shape()
@@ -112,18 +505,27 @@ namespace mousetrap
             return;
         }
 
-        glGenVertexArrays(1, &_internal->vertex_array_id);
-        glGenBuffers(1, &_internal->vertex_buffer_id);
-
-        _internal->vertex_data = other._internal->vertex_data;
-        _internal->color = other._internal->color;
+        *_internal->vertex_data = *other._internal->vertex_data;
+        *_internal->compact_vertex_data = *other._internal->compact_vertex_data;
+        *_internal->color = *other._internal->color;
         _internal->is_visible = other._internal->is_visible;
         _internal->render_type = other._internal->render_type;
-        _internal->vertices = other._internal->vertices;
-        _internal->indices = other._internal->indices;
+        _internal->shape_type = other._internal->shape_type;
+        *_internal->indices = *other._internal->indices;
         _internal->texture = other._internal->texture;
+        _internal->instance_buffer = other._internal->instance_buffer;
+
+        if (_internal->vertex_format != other._internal->vertex_format)
+        {
+            // stride changed, the buffer has to be reallocated even if the number of vertices is the same
+            _internal->vertex_format = other._internal->vertex_format;
+            _internal->vertex_buffer_size = 0;
+            detail::shape_internal_bind_vertex_format(_internal);
+        }
 
-        update_data(true, true, true);
+        detail::shape_internal_geometry_changed(_internal);
+        queue_update(0, detail::shape_internal_get_n_vertices(_internal));
+        update_indices();
     }
 
     Shape& Shape::operator=(const Shape& other)
@@ -137,20 +539,27 @@ namespace mousetrap
         if (&other == this)
             return *this;
 
-        g_object_ref(other._internal);
-
-        glGenVertexArrays(1, &_internal->vertex_array_id);
-        glGenBuffers(1, &_internal->vertex_buffer_id);
-
-        _internal->vertex_data = other._internal->vertex_data;
-        _internal->color = other._internal->color;
+        *_internal->vertex_data = *other._internal->vertex_data;
+        *_internal->compact_vertex_data = *other._internal->compact_vertex_data;
+        *_internal->color = *other._internal->color;
         _internal->is_visible = other._internal->is_visible;
         _internal->render_type = other._internal->render_type;
-        _internal->vertices = other._internal->vertices;
-        _internal->indices = other._internal->indices;
+        _internal->shape_type = other._internal->shape_type;
+        *_internal->indices = *other._internal->indices;
         _internal->texture = other._internal->texture;
+        _internal->instance_buffer = other._internal->instance_buffer;
 
-        update_data();
+        if (_internal->vertex_format != other._internal->vertex_format)
+        {
+            // stride changed, the buffer has to be reallocated even if the number of vertices is the same
+            _internal->vertex_format = other._internal->vertex_format;
+            _internal->vertex_buffer_size = 0;
+            detail::shape_internal_bind_vertex_format(_internal);
+        }
+
+        detail::shape_internal_geometry_changed(_internal);
+        queue_update(0, detail::shape_internal_get_n_vertices(_internal));
+        update_indices();
         return *this;
     }
 
@@ -165,20 +574,27 @@ namespace mousetrap
 
         _internal->vertex_array_id = other._internal->vertex_array_id;
         _internal->vertex_buffer_id = other._internal->vertex_buffer_id;
+        _internal->element_buffer_id = other._internal->element_buffer_id;
+        _internal->index_type = other._internal->index_type;
+        _internal->n_indices = other._internal->n_indices;
+        _internal->vertex_buffer_size = other._internal->vertex_buffer_size;
+        *_internal->dirty_ranges = *other._internal->dirty_ranges;
 
+        _internal->vertex_format = (other._internal->vertex_format);
         _internal->vertex_data = (other._internal->vertex_data);
+        _internal->compact_vertex_data = (other._internal->compact_vertex_data);
         _internal->color = (other._internal->color);
         _internal->is_visible = (other._internal->is_visible);
         _internal->render_type = (other._internal->render_type);
-        _internal->vertices = (other._internal->vertices);
         _internal->indices = (other._internal->indices);
         _internal->texture = (other._internal->texture);
+        _internal->instance_buffer = (other._internal->instance_buffer);
+        _internal->bound_instance_buffer_id = (other._internal->bound_instance_buffer_id);
 
         other._internal->vertex_buffer_id = 0;
         other._internal->vertex_array_id = 0;
+        other._internal->element_buffer_id = 0;
         other._internal = nullptr;
-
-        update_data();
     }
 
     Shape& Shape::operator=(Shape&& other) noexcept
@@ -193,17 +609,27 @@ namespace mousetrap
 
         _internal->vertex_array_id = other._internal->vertex_array_id;
         _internal->vertex_buffer_id = other._internal->vertex_buffer_id;
+        _internal->element_buffer_id = other._internal->element_buffer_id;
+        _internal->index_type = other._internal->index_type;
+        _internal->n_indices = other._internal->n_indices;
+        _internal->vertex_buffer_size = other._internal->vertex_buffer_size;
+        *_internal->dirty_ranges = *other._internal->dirty_ranges;
 
+        _internal->vertex_format = (other._internal->vertex_format);
         _internal->vertex_data = (other._internal->vertex_data);
+        _internal->compact_vertex_data = (other._internal->compact_vertex_data);
         _internal->color = (other._internal->color);
         _internal->is_visible = (other._internal->is_visible);
         _internal->render_type = (other._internal->render_type);
-        _internal->vertices = (other._internal->vertices);
         _internal->indices = (other._internal->indices);
         _internal->texture = (other._internal->texture);
+        _internal->instance_buffer = (other._internal->instance_buffer);
+        _internal->bound_instance_buffer_id = (other._internal->bound_instance_buffer_id);
+        detail::shape_internal_geometry_changed(_internal);
 
         other._internal->vertex_buffer_id = 0;
         other._internal->vertex_array_id = 0;
+        other._internal->element_buffer_id = 0;
 
         return *this;
     }
@@ -229,138 +655,185 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->vertex_data->clear();
-        _internal->vertex_data->reserve(_internal->vertices->size());
+        detail::shape_internal_geometry_changed(_internal);
+        queue_update(0, detail::shape_internal_get_n_vertices(_internal));
+        update_indices();
+    }
 
-        for (auto &v : *_internal->vertices)
-        {
-            _internal->vertex_data->emplace_back();
-            auto &data = _internal->vertex_data->back();
+    void Shape::queue_update(uint64_t first, uint64_t last) const
+    {
+        if (detail::is_opengl_disabled())
+            return;
 
-            auto as_gl_position = to_gl_position(v.position);
+        if (first >= last)
+            return;
 
-            data._position[0] = as_gl_position[0];
-            data._position[1] = as_gl_position[1];
-            data._position[2] = as_gl_position[2];
+        _internal->version = detail::render_state_next_version();
 
-            data._color[0] = v.color.r;
-            data._color[1] = v.color.g;
-            data._color[2] = v.color.b;
-            data._color[3] = v.color.a;
+        // ranges closer than this are uploaded as one, the extra vertices are cheaper than another call
+        static const uint64_t merge_distance = 16;
 
-            data._texture_coordinates[0] = v.texture_coordinates[0];
-            data._texture_coordinates[1] = v.texture_coordinates[1];
+        // past this many ranges, the two closest ones are merged
+        static const uint64_t max_n_ranges = 32;
+
+        auto& ranges = *_internal->dirty_ranges;
+
+        // absorb all ranges that overlap or are close to [first, last), keeping the list sorted
+        auto it = std::lower_bound(ranges.begin(), ranges.end(), first, [](const std::pair<uint64_t, uint64_t>& range, uint64_t value){
+            return range.second + merge_distance < value;
+        });
+
+        auto end = it;
+        while (end != ranges.end() and end->first <= last + merge_distance)
+        {
+            first = std::min(first, end->first);
+            last = std::max(last, end->second);
+            end++;
         }
 
-        update_data(true, true, true);
+        it = ranges.erase(it, end);
+        ranges.insert(it, {first, last});
+
+        if (ranges.size() > max_n_ranges)
+        {
+            uint64_t closest = 0;
+            for (uint64_t i = 1; i + 1 < ranges.size(); ++i)
+                if (ranges.at(i + 1).first - ranges.at(i).second < ranges.at(closest + 1).first - ranges.at(closest).second)
+                    closest = i;
+
+            ranges.at(closest).second = ranges.at(closest + 1).second;
+            ranges.erase(ranges.begin() + closest + 1);
+        }
     }
 
-    void Shape::update_data(bool update_position, bool update_color, bool update_tex_coords) const
+    void Shape::update_data() const
     {
         if (detail::is_opengl_disabled())
             return;
 
-        glBindVertexArray(_internal->vertex_array_id);
-        glBindBuffer(GL_ARRAY_BUFFER, _internal->vertex_buffer_id);
-        glBufferData(GL_ARRAY_BUFFER, _internal->vertex_data->size() * sizeof(struct detail::VertexInfo), _internal->vertex_data->data(), GL_STATIC_DRAW);
+        auto n_vertices = detail::shape_internal_get_n_vertices(_internal);
+        auto stride = detail::shape_internal_get_vertex_stride(_internal);
+        auto* data = detail::shape_internal_get_vertex_buffer(_internal);
 
-        if (update_position)
+        auto& ranges = *_internal->dirty_ranges;
+
+        if (n_vertices != _internal->vertex_buffer_size)
         {
-            auto position_location = Shader::get_vertex_position_location();
-            glEnableVertexAttribArray(position_location);
-            glVertexAttribPointer(position_location,
-                                  3,
-                                  GL_FLOAT,
-                                  GL_FALSE,
-                                  sizeof(struct detail::VertexInfo),
-                                  (GLvoid *) (G_STRUCT_OFFSET(struct detail::VertexInfo, _position))
-            );
+            // number of vertices changed, reallocate
+            ranges.clear();
+            glBindBuffer(GL_ARRAY_BUFFER, _internal->vertex_buffer_id);
+            glBufferData(GL_ARRAY_BUFFER, n_vertices * stride, data, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            detail::gl_statistics_count_upload(n_vertices * stride);
+
+            _internal->vertex_buffer_size = n_vertices;
+            return;
         }
 
-        if (update_color)
+        uint64_t n_dirty = 0;
+        for (auto& range : ranges)
         {
-            auto color_location = Shader::get_vertex_color_location();
-            glEnableVertexAttribArray(color_location);
-            glVertexAttribPointer(color_location,
-                                  4,
-                                  GL_FLOAT,
-                                  GL_FALSE,
-                                  sizeof(struct detail::VertexInfo),
-                                  (GLvoid *) (G_STRUCT_OFFSET(struct detail::VertexInfo, _color))
-                                  );
+            range.second = std::min<uint64_t>(range.second, n_vertices);
+            if (range.first < range.second)
+                n_dirty += range.second - range.first;
         }
 
-        if (update_tex_coords)
+        if (n_dirty == 0)
         {
-            auto texture_coordinate_location = Shader::get_vertex_texture_coordinate_location();
-            glEnableVertexAttribArray(texture_coordinate_location);
-            glVertexAttribPointer(texture_coordinate_location,
-                                  2,
-                                  GL_FLOAT,
-                                  GL_FALSE,
-                                  sizeof(struct detail::VertexInfo),
-                                  (GLvoid *) (G_STRUCT_OFFSET(struct detail::VertexInfo, _texture_coordinates))            );
+            ranges.clear();
+            return;
         }
 
+        glBindBuffer(GL_ARRAY_BUFFER, _internal->vertex_buffer_id);
+
+        if (n_dirty * 2 > n_vertices)
+        {
+            // most of the buffer changed, orphan the old store instead of waiting for draws that still read from it
+            glBufferData(GL_ARRAY_BUFFER, n_vertices * stride, data, GL_DYNAMIC_DRAW);
+            detail::gl_statistics_count_upload(n_vertices * stride);
+        }
+        else
+        {
+            for (auto& range : ranges)
+            {
+                if (range.first >= range.second)
+                    continue;
+
+                glBufferSubData(
+                    GL_ARRAY_BUFFER,
+                    range.first * stride,
+                    (range.second - range.first) * stride,
+                    data + range.first * stride
+                );
+            }
+            detail::gl_statistics_count_upload(n_dirty * stride);
+        }
+
+        ranges.clear();
+
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
     }
 
-    void Shape::update_position() const
+    void Shape::update_indices() const
     {
         if (detail::is_opengl_disabled())
             return;
 
-        for (uint64_t i = 0; i < _internal->vertices->size(); ++i)
-        {
-            auto& v = _internal->vertices->at(i);
-            auto& data = _internal->vertex_data->at(i);
+        _internal->n_indices = _internal->indices->size();
+        _internal->version = detail::render_state_next_version();
 
-            auto as_gl_position = to_gl_position(v.position);
+        // element buffer binding is part of the vertex array state
+        detail::gl_state_bind_vertex_array(_internal->vertex_array_id);
 
-            data._position[0] = as_gl_position[0];
-            data._position[1] = as_gl_position[1];
-            data._position[2] = as_gl_position[2];
+        if (detail::shape_internal_get_n_vertices(_internal) <= std::numeric_limits<GLushort>::max() + 1)
+        {
+            auto as_short = std::vector<GLushort>(_internal->indices->begin(), _internal->indices->end());
+            _internal->index_type = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, as_short.size() * sizeof(GLushort), as_short.data(), GL_STATIC_DRAW);
+            detail::gl_statistics_count_upload(as_short.size() * sizeof(GLushort));
+        }
+        else
+        {
+            _internal->index_type = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, _internal->indices->size() * sizeof(GLuint), _internal->indices->data(), GL_STATIC_DRAW);
+            detail::gl_statistics_count_upload(_internal->indices->size() * sizeof(GLuint));
         }
 
-        update_data(true, false, false);
+        detail::gl_state_bind_vertex_array(0);
     }
 
-    void Shape::update_color() const
+    void Shape::update_vertex(uint64_t i) const
     {
         if (detail::is_opengl_disabled())
             return;
 
-        for (uint64_t i = 0; i < _internal->vertices->size(); ++i)
-        {
-            auto& v = _internal->vertices->at(i);
-            auto& data = _internal->vertex_data->at(i);
+        detail::shape_internal_geometry_changed(_internal);
+        queue_update(i, i + 1);
+    }
 
-            data._color[0] = v.color.r;
-            data._color[1] = v.color.g;
-            data._color[2] = v.color.b;
-            data._color[3] = v.color.a;
-        }
+    void Shape::update_position() const
+    {
+        if (detail::is_opengl_disabled())
+            return;
 
-        update_data(false, true, false);
+        detail::shape_internal_geometry_changed(_internal);
+        queue_update(0, detail::shape_internal_get_n_vertices(_internal));
     }
 
-    void Shape::update_texture_coordinate() const
+    void Shape::update_color() const
     {
         if (detail::is_opengl_disabled())
             return;
 
-        for (uint64_t i = 0; i < _internal->vertices->size(); ++i)
-        {
-            auto& v = _internal->vertices->at(i);
-            auto& data = _internal->vertex_data->at(i);
+        queue_update(0, detail::shape_internal_get_n_vertices(_internal));
+    }
 
-            data._texture_coordinates[0] = v.texture_coordinates[0];
-            data._texture_coordinates[1] = v.texture_coordinates[1];
-        }
+    void Shape::update_texture_coordinate() const
+    {
+        if (detail::is_opengl_disabled())
+            return;
 
-        update_data(false, false, true);
+        queue_update(0, detail::shape_internal_get_n_vertices(_internal));
     }
 
     void Shape::render(const Shader& shader, GLTransform transform) const
@@ -371,39 +844,68 @@ namespace mousetrap
         if (not _internal->is_visible)
             return;
 
-        glUseProgram(shader.get_program_id());
-        glUniformMatrix4fv(shader.get_uniform_location("_transform"), 1, GL_FALSE, &(transform.transform[0][0]));
+        update_data();
+
+        uint64_t n_instances = 0;
+        GLNativeHandle instance_buffer_id = 0;
+
+        if (_internal->instance_buffer != nullptr)
+        {
+            auto* instance_buffer = (detail::InstanceBufferInternal*) _internal->instance_buffer->get_internal();
+            n_instances = instance_buffer->instance_data->size();
+
+            if (n_instances == 0)
+                return;
+
+            detail::instance_buffer_internal_update(instance_buffer);
+            instance_buffer_id = instance_buffer->buffer_id;
+        }
+
+        if (_internal->bound_instance_buffer_id != instance_buffer_id)
+            detail::shape_internal_bind_instance_buffer(_internal, instance_buffer_id);
+
+        auto program_id = n_instances > 0 ? shader.get_instanced_program_id() : shader.get_program_id();
+
+        auto* uniforms = detail::shader_internal_get_uniform_cache((detail::ShaderInternal*) shader.get_internal(), program_id);
 
-        glUniform1i(shader.get_uniform_location("_texture_set"), _internal->texture != nullptr ? GL_TRUE : GL_FALSE);
+        detail::gl_state_use_program(program_id);
+        glUniformMatrix4fv(uniforms->transform_location, 1, GL_FALSE, &(transform.transform[0][0]));
+        glUniform1i(uniforms->texture_set_location, _internal->texture != nullptr ? GL_TRUE : GL_FALSE);
 
         if (_internal->texture != nullptr)
             _internal->texture->bind();
 
-        glBindVertexArray(_internal->vertex_array_id);
-        glDrawElements(_internal->render_type, _internal->indices->size(), GL_UNSIGNED_INT, _internal->indices->data());
+        detail::gl_state_bind_vertex_array(_internal->vertex_array_id);
 
-        if (_internal->texture != nullptr)
-            _internal->texture->unbind();
+        if (n_instances > 0)
+        {
+            glDrawElementsInstanced(_internal->render_type, _internal->n_indices, _internal->index_type, nullptr, n_instances);
+            detail::gl_statistics_count_draw(_internal->n_indices * n_instances);
+        }
+        else
+        {
+            glDrawElements(_internal->render_type, _internal->n_indices, _internal->index_type, nullptr);
+            detail::gl_statistics_count_draw(_internal->n_indices);
+        }
 
-        glBindVertexArray(0);
-        glUseProgram(0);
     }
 
-    std::vector<Vector2f> Shape::sort_by_angle(const std::vector<Vector2f>& in)
+    std::vector<Vector2f> Shape::sort_by_angle(const Vector2f* points, uint64_t n)
     {
         if (detail::is_opengl_disabled())
             return {};
 
         auto center = Vector2f(0, 0);
-        for (const auto& pos : in)
-            center += pos;
+        for (uint64_t i = 0; i < n; ++i)
+            center += points[i];
 
-        uint64_t n = in.size();
         center /= Vector2f(n, n);
 
         std::vector<std::pair<Vector2f, Angle>> by_angle;
-        for (const auto& pos : in)
-            by_angle.emplace_back(pos, radians(std::atan2(pos.x - center.x, pos.y - center.y)));
+        by_angle.reserve(n);
+
+        for (uint64_t i = 0; i < n; ++i)
+            by_angle.emplace_back(points[i], radians(std::atan2(points[i].x - center.x, points[i].y - center.y)));
 
         std::sort(by_angle.begin(), by_angle.end(), [](const std::pair<Vector2f, Angle>& a, const std::pair<Vector2f, Angle>& b)
         {
@@ -411,7 +913,7 @@ namespace mousetrap
         });
 
         auto out = std::vector<Vector2f>();
-        out.reserve(in.size());
+        out.reserve(n);
 
         for (auto& pair : by_angle)
             out.push_back(pair.first);
@@ -424,10 +926,8 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->vertices->clear();
-        _internal->indices->clear();
-
-        _internal->vertices->push_back(Vertex(p.x, p.y, *_internal->color));
+        detail::shape_internal_reset(_internal, 1, 1);
+        detail::shape_internal_push_vertex(_internal, p.x, p.y);
         _internal->indices->push_back(0);
 
         _internal->render_type = GL_POINTS;
@@ -436,17 +936,20 @@ namespace mousetrap
     }
 
     void Shape::as_points(const std::vector<Vector2f>& points)
+    {
+        as_points(points.data(), points.size());
+    }
+
+    void Shape::as_points(const Vector2f* points, uint64_t n)
     {
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->vertices->clear();
-        _internal->indices->clear();
+        detail::shape_internal_reset(_internal, n, n);
 
-        for (uint64_t i = 0; i < points.size(); ++i)
+        for (uint64_t i = 0; i < n; ++i)
         {
-            auto p = points.at(i);
-            _internal->vertices->push_back(Vertex(p.x, p.y, *_internal->color));
+            detail::shape_internal_push_vertex(_internal, points[i].x, points[i].y);
             _internal->indices->push_back(i);
         }
 
@@ -460,12 +963,10 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        *_internal->vertices =
-        {
-            Vertex(a.x, a.y, *_internal->color),
-            Vertex(b.x, b.y, *_internal->color),
-            Vertex(c.x, c.y, *_internal->color)
-        };
+        detail::shape_internal_reset(_internal, 3, 3);
+        detail::shape_internal_push_vertex(_internal, a.x, a.y);
+        detail::shape_internal_push_vertex(_internal, b.x, b.y);
+        detail::shape_internal_push_vertex(_internal, c.x, c.y);
 
         *_internal->indices = {0, 1, 2};
         _internal->render_type = GL_TRIANGLES;
@@ -478,18 +979,17 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        *_internal->vertices =
-        {
-            Vertex(top_left.x, top_left.y, *_internal->color),
-            Vertex(top_left.x + size.x, top_left.y, *_internal->color),
-            Vertex(top_left.x + size.x, top_left.y - size.y, *_internal->color),
-            Vertex(top_left.x, top_left.y - size.y, *_internal->color)
-        };
+        detail::shape_internal_reset(_internal, 4, 4);
+        detail::shape_internal_push_vertex(_internal, top_left.x, top_left.y);
+        detail::shape_internal_push_vertex(_internal, top_left.x + size.x, top_left.y);
+        detail::shape_internal_push_vertex(_internal, top_left.x + size.x, top_left.y - size.y);
+        detail::shape_internal_push_vertex(_internal, top_left.x, top_left.y - size.y);
 
-        _internal->vertices->at(0).texture_coordinates = {0, 0};
-        _internal->vertices->at(1).texture_coordinates = {1, 0};
-        _internal->vertices->at(2).texture_coordinates = {1, 1};
-        _internal->vertices->at(3).texture_coordinates = {0, 1};
+        const Vector2f texture_coordinates[4] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+        for (uint64_t i = 0; i < 4; ++i)
+            detail::shape_internal_visit_vertex(_internal, i, [&](auto& data) {
+                detail::shape_internal_set_vertex_texture_coordinate(data, texture_coordinates[i]);
+            });
 
         *_internal->indices = {0, 1, 2, 3};
         _internal->render_type = GL_TRIANGLE_FAN;
@@ -510,24 +1010,22 @@ namespace mousetrap
         float b = y_height;
 
         auto v = [&](float x, float y) {
-            return Vertex(x, y, *_internal->color);
+            detail::shape_internal_push_vertex(_internal, x, y);
         };
 
-        *_internal->vertices =
-        {
-            v(x, y),
-            v(x + w, y),
-            v(x, y - b),
-            v(x + a, y - b),
-            v(x + w - a, y - b),
-            v(x + w, y - b),
-            v(x, y - h + b),
-            v(x + a, y - h + b),
-            v(x + w - a, y - h + b),
-            v(x + w, y - h + b),
-            v(x, y - h),
-            v(x + w, y - h)
-        };
+        detail::shape_internal_reset(_internal, 12, 24);
+        v(x, y);
+        v(x + w, y);
+        v(x, y - b);
+        v(x + a, y - b);
+        v(x + w - a, y - b);
+        v(x + w, y - b);
+        v(x, y - h + b);
+        v(x + a, y - h + b);
+        v(x + w - a, y - h + b);
+        v(x + w, y - h + b);
+        v(x, y - h);
+        v(x + w, y - h);
 
         *_internal->indices = {
             0, 1, 5,
@@ -550,11 +1048,9 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        *_internal->vertices =
-        {
-            Vertex(a.x, a.y, *_internal->color),
-            Vertex(b.x, b.y, *_internal->color)
-        };
+        detail::shape_internal_reset(_internal, 2, 2);
+        detail::shape_internal_push_vertex(_internal, a.x, a.y);
+        detail::shape_internal_push_vertex(_internal, b.x, b.y);
 
         *_internal->indices = {0, 1};
         _internal->render_type = GL_LINES;
@@ -563,21 +1059,25 @@ namespace mousetrap
     }
 
     void Shape::as_lines(const std::vector<std::pair<Vector2f, Vector2f>>& in)
+    {
+        as_lines(in.data(), in.size());
+    }
+
+    void Shape::as_lines(const std::pair<Vector2f, Vector2f>* lines, uint64_t n)
     {
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->vertices->clear();
-        for (const auto& pair : in)
+        detail::shape_internal_reset(_internal, 2 * n, 2 * n);
+
+        for (uint64_t i = 0; i < n; ++i)
         {
-            _internal->vertices->emplace_back(pair.first.x, pair.first.y, *_internal->color);
-            _internal->vertices->emplace_back(pair.second.x, pair.second.y, *_internal->color);
+            detail::shape_internal_push_vertex(_internal, lines[i].first.x, lines[i].first.y);
+            detail::shape_internal_push_vertex(_internal, lines[i].second.x, lines[i].second.y);
+            _internal->indices->push_back(2 * i);
+            _internal->indices->push_back(2 * i + 1);
         }
 
-        _internal->indices->clear();
-        for (uint64_t i = 0; i < _internal->vertices->size(); ++i)
-            _internal->indices->push_back(i);
-
         _internal->render_type = GL_LINES;
         _internal->shape_type = detail::ShapeType::LINES;
         initialize();
@@ -611,21 +1111,20 @@ namespace mousetrap
 
         const float step = 360.f / n_outer_vertices;
 
-        _internal->vertices->clear();
-        _internal->vertices->push_back(Vertex(center.x, center.y, *_internal->color));
+        // float accumulation of the angle may produce one additional vertex
+        detail::shape_internal_reset(_internal, n_outer_vertices + 2, n_outer_vertices + 3);
+        detail::shape_internal_push_vertex(_internal, center.x, center.y);
 
         for (float angle = 0; angle < 360; angle += step)
         {
             auto as_radians = angle * 3.141592 / 180.f;
-            _internal->vertices->emplace_back(
+            detail::shape_internal_push_vertex(_internal,
                 center.x + cos(as_radians) * x_radius,
-                center.y + sin(as_radians) * y_radius,
-                *_internal->color
+                center.y + sin(as_radians) * y_radius
             );
         }
 
-        _internal->indices->clear();
-        for (uint64_t i = 0; i < _internal->vertices->size(); ++i)
+        for (uint64_t i = 0; i < detail::shape_internal_get_n_vertices(_internal); ++i)
             _internal->indices->push_back(i);
 
         _internal->indices->push_back(1);
@@ -650,28 +1149,24 @@ namespace mousetrap
             return;
 
         const float step = 360.f / n_outer_vertices;
-        _internal->vertices->clear();
+        detail::shape_internal_reset(_internal, 2 * (n_outer_vertices + 1), 6 * n_outer_vertices);
 
         for (float angle = 0; angle < 360; angle += step)
         {
             auto as_radians = angle * 3.141592 / 180.f;
-            _internal->vertices->emplace_back(
+            detail::shape_internal_push_vertex(_internal,
                 center.x + cos(as_radians) * x_radius,
-                center.y + sin(as_radians) * y_radius,
-                *_internal->color
+                center.y + sin(as_radians) * y_radius
             );
 
-            _internal->vertices->emplace_back(
+            detail::shape_internal_push_vertex(_internal,
                 center.x + cos(as_radians) * (x_radius - x_thickness),
-                center.y + sin(as_radians) * (y_radius - y_thickness),
-                *_internal->color
+                center.y + sin(as_radians) * (y_radius - y_thickness)
             );
         }
 
         _internal->render_type = GL_TRIANGLES;
         _internal->shape_type = detail::ShapeType::ELLIPTICAL_RING;
-
-        _internal->indices->clear();
         for (uint64_t i = 0; i < n_outer_vertices - 1; ++i)
         {
             auto a = i * 2;
@@ -683,7 +1178,7 @@ namespace mousetrap
             _internal->indices->push_back(a+3);
         }
 
-        auto a = _internal->vertices->size() - 2;
+        auto a = detail::shape_internal_get_n_vertices(_internal) - 2;
         _internal->indices->push_back(a);
         _internal->indices->push_back(0);
         _internal->indices->push_back(1);
@@ -696,18 +1191,21 @@ namespace mousetrap
     }
 
     void Shape::as_line_strip(const std::vector<Vector2f>& positions)
+    {
+        as_line_strip(positions.data(), positions.size());
+    }
+
+    void Shape::as_line_strip(const Vector2f* points, uint64_t n)
     {
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->vertices->clear();
-        _internal->indices->clear();
+        detail::shape_internal_reset(_internal, n, n);
 
-        uint64_t i = 0;
-        for (auto& position : positions)
+        for (uint64_t i = 0; i < n; ++i)
         {
-            _internal->vertices->emplace_back(position.x, position.y, *_internal->color);
-            _internal->indices->push_back(i++);
+            detail::shape_internal_push_vertex(_internal, points[i].x, points[i].y);
+            _internal->indices->push_back(i);
         }
 
         _internal->render_type = GL_LINE_STRIP;
@@ -720,15 +1218,13 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->vertices->clear();
-        _internal->indices->clear();
-
-        auto positions = sort_by_angle(positions_in);
+        auto positions = sort_by_angle(positions_in.data(), positions_in.size());
+        detail::shape_internal_reset(_internal, positions.size(), positions.size());
 
         uint64_t i = 0;
         for (auto& position : positions)
         {
-            _internal->vertices->emplace_back(position.x, position.y, *_internal->color);
+            detail::shape_internal_push_vertex(_internal, position.x, position.y);
             _internal->indices->push_back(i++);
         }
 
@@ -738,20 +1234,22 @@ namespace mousetrap
     }
 
     void Shape::as_polygon(const std::vector<Vector2f>& positions_in)
+    {
+        as_polygon(positions_in.data(), positions_in.size());
+    }
+
+    void Shape::as_polygon(const Vector2f* points, uint64_t n)
     {
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->vertices->clear();
-        _internal->indices->clear();
-
-        auto positions = sort_by_angle(positions_in);
+        auto positions = sort_by_angle(points, n);
+        detail::shape_internal_reset(_internal, n, n);
 
-        uint64_t i = 0;
-        for (auto& position : positions)
+        for (uint64_t i = 0; i < n; ++i)
         {
-            _internal->vertices->emplace_back(position.x, position.y, *_internal->color);
-            _internal->indices->push_back(i++);
+            detail::shape_internal_push_vertex(_internal, positions[i].x, positions[i].y);
+            _internal->indices->push_back(i);
         }
 
         _internal->render_type = GL_TRIANGLE_FAN;
@@ -764,9 +1262,6 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        _internal->vertices->clear();
-        _internal->indices->clear();
-
         std::vector<std::pair<Vector2f, Vector2f>> positions;
 
         auto type = shape._internal->shape_type;
@@ -978,21 +1473,9 @@ namespace mousetrap
         float hue = 0;
         float hue_step = 1.f / positions.size();
 
-        _internal->vertices->clear();
-
-        for (const auto& pair : positions)
-        {
-            _internal->vertices->emplace_back(pair.first.x, pair.first.y, *_internal->color);
-            _internal->vertices->emplace_back(pair.second.x, pair.second.y, *_internal->color);
-        }
-
-        _internal->indices->clear();
-        for (uint64_t i = 0; i < _internal->vertices->size(); ++i)
-            _internal->indices->push_back(i);
-
-        _internal->render_type = GL_LINES;
+        // shape may be this shape, so its vertices are only discarded once all positions were read
+        as_lines(positions.data(), positions.size());
         _internal->shape_type = detail::ShapeType::OUTLINE;
-        initialize();
     }
 
     void Shape::set_vertex_color(uint64_t i, RGBA color)
@@ -1000,17 +1483,18 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        if (i > _internal->vertices->size())
+        if (i >= detail::shape_internal_get_n_vertices(_internal))
         {
             std::stringstream str;
-            str << "In mousetrap::Shape::set_vertex_internal->color: index " << i << " out of bounds for an object with " << _internal->vertices->size() << " vertices" <<  std::endl;
+            str << "In mousetrap::Shape::set_vertex_internal->color: index " << i << " out of bounds for an object with " << detail::shape_internal_get_n_vertices(_internal) << " vertices" <<  std::endl;
             log::critical(str.str(), MOUSETRAP_DOMAIN);
             return;
         }
 
-        _internal->vertices->at(i).color = color;
-        update_color();
-        update_data(false, true, false);
+        detail::shape_internal_visit_vertex(_internal, i, [&](auto& data) {
+            detail::shape_internal_set_vertex_color(data, color);
+        });
+        update_vertex(i);
     }
 
     RGBA Shape::get_vertex_color(uint64_t index) const
@@ -1018,15 +1502,17 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return RGBA(0, 0, 0, 0);
 
-        if (index > _internal->vertices->size())
+        if (index >= detail::shape_internal_get_n_vertices(_internal))
         {
             std::stringstream str;
-            str << "In mousetrap::Shape::get_vertex_internal->color: index " << index << " out of bounds for an object with " << _internal->vertices->size() << " vertices";
+            str << "In mousetrap::Shape::get_vertex_internal->color: index " << index << " out of bounds for an object with " << detail::shape_internal_get_n_vertices(_internal) << " vertices";
             log::critical(str.str(), MOUSETRAP_DOMAIN);
 
             return RGBA(0, 0, 0, 0);
         }
-        return RGBA(_internal->vertices->at(index).color);
+        return detail::shape_internal_visit_vertex(_internal, index, [](auto& data) {
+            return detail::shape_internal_get_vertex_color(data);
+        });
     }
 
     void Shape::set_vertex_position(uint64_t i, Vector3f position)
@@ -1034,17 +1520,18 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        if (i > _internal->vertices->size())
+        if (i >= detail::shape_internal_get_n_vertices(_internal))
         {
             std::stringstream str;
-            str << "[ERROR] In mousetrap::Shape::set_vertex_position: index " << i << " out of bounds for an object with " << _internal->vertices->size() << " vertices";
+            str << "[ERROR] In mousetrap::Shape::set_vertex_position: index " << i << " out of bounds for an object with " << detail::shape_internal_get_n_vertices(_internal) << " vertices";
             log::critical(str.str(), MOUSETRAP_DOMAIN);
             return;
         }
 
-        _internal->vertices->at(i).position = position;
-        update_position();
-        update_data(true, false, false);
+        detail::shape_internal_visit_vertex(_internal, i, [&](auto& data) {
+            detail::shape_internal_set_vertex_position(data, position);
+        });
+        update_vertex(i);
     }
 
     Vector3f Shape::get_vertex_position(uint64_t i) const
@@ -1052,15 +1539,17 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return Vector3f(0, 0, 0);
 
-        if (i > _internal->vertices->size())
+        if (i >= detail::shape_internal_get_n_vertices(_internal))
         {
             std::stringstream str;
-            str << "In mousetrap::Shape::get_vertex_position: index " << i << " out of bounds for an object with " << _internal->vertices->size() << " vertices";
+            str << "In mousetrap::Shape::get_vertex_position: index " << i << " out of bounds for an object with " << detail::shape_internal_get_n_vertices(_internal) << " vertices";
             log::critical(str.str(), MOUSETRAP_DOMAIN);
             return Vector3f();
         }
 
-        return _internal->vertices->at(i).position;
+        return detail::shape_internal_visit_vertex(_internal, i, [](auto& data) {
+            return detail::shape_internal_get_vertex_position(data);
+        });
     }
 
     void Shape::set_vertex_texture_coordinate(uint64_t i, Vector2f coordinates)
@@ -1068,17 +1557,18 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        if (i > _internal->vertices->size())
+        if (i >= detail::shape_internal_get_n_vertices(_internal))
         {
             std::stringstream str;
-            str << "In mousetrap::Shape::set_vertex_internal->texture_coordinate: index " << i << " out of bounds for an object with " << _internal->vertices->size() << " vertices";
+            str << "In mousetrap::Shape::set_vertex_internal->texture_coordinate: index " << i << " out of bounds for an object with " << detail::shape_internal_get_n_vertices(_internal) << " vertices";
             log::critical(str.str(), MOUSETRAP_DOMAIN);
             return;
         }
 
-        _internal->vertices->at(i).texture_coordinates = coordinates;
-        update_texture_coordinate();
-        update_data(false, false, true);
+        detail::shape_internal_visit_vertex(_internal, i, [&](auto& data) {
+            detail::shape_internal_set_vertex_texture_coordinate(data, coordinates);
+        });
+        update_vertex(i);
     }
 
     Vector2f Shape::get_vertex_texture_coordinate(uint64_t i) const
@@ -1086,13 +1576,15 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return Vector2f(0, 0);
 
-        if (i > _internal->vertices->size())
+        if (i >= detail::shape_internal_get_n_vertices(_internal))
         {
-            std::cerr << "[ERROR] In mousetrap::Shape::get_vertex_position: index " << i << " out of bounds for an object with " << _internal->vertices->size() << " vertices" <<  std::endl;
+            std::cerr << "[ERROR] In mousetrap::Shape::get_vertex_position: index " << i << " out of bounds for an object with " << detail::shape_internal_get_n_vertices(_internal) << " vertices" <<  std::endl;
             return Vector2f();
         }
 
-        return _internal->vertices->at(i).texture_coordinates;
+        return detail::shape_internal_visit_vertex(_internal, i, [](auto& data) {
+            return detail::shape_internal_get_vertex_texture_coordinate(data);
+        });
     }
 
     uint64_t Shape::get_n_vertices() const
@@ -1100,7 +1592,56 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return 0;
 
-        return _internal->vertices->size();
+        return detail::shape_internal_get_n_vertices(_internal);
+    }
+
+    void Shape::set_vertex_format(VertexFormat format)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        if (format == _internal->vertex_format)
+            return;
+
+        auto convert = [](const auto& from, auto& to) {
+            to.clear();
+            to.reserve(from.size());
+            for (auto& in : from)
+            {
+                auto& data = to.emplace_back();
+                detail::shape_internal_set_vertex_position(data, detail::shape_internal_get_vertex_position(in));
+                detail::shape_internal_set_vertex_color(data, detail::shape_internal_get_vertex_color(in));
+                detail::shape_internal_set_vertex_texture_coordinate(data, detail::shape_internal_get_vertex_texture_coordinate(in));
+            }
+        };
+
+        // only the new format keeps a copy
+        if (format == VertexFormat::COMPACT)
+        {
+            convert(*_internal->vertex_data, *_internal->compact_vertex_data);
+            std::vector<detail::VertexInfo>().swap(*_internal->vertex_data);
+        }
+        else
+        {
+            convert(*_internal->compact_vertex_data, *_internal->vertex_data);
+            std::vector<detail::CompactVertexInfo>().swap(*_internal->compact_vertex_data);
+        }
+
+        _internal->vertex_format = format;
+        detail::shape_internal_bind_vertex_format(_internal);
+
+        // stride changed, the buffer has to be reallocated even if the number of vertices is the same
+        _internal->vertex_buffer_size = 0;
+        detail::shape_internal_geometry_changed(_internal);
+        queue_update(0, detail::shape_internal_get_n_vertices(_internal));
+    }
+
+    VertexFormat Shape::get_vertex_format() const
+    {
+        if (detail::is_opengl_disabled())
+            return VertexFormat::FULL;
+
+        return _internal->vertex_format;
     }
 
     void Shape::set_color(RGBA color)
@@ -1110,8 +1651,9 @@ namespace mousetrap
 
         *_internal->color = color;
 
-        for (auto& v : *_internal->vertices)
-            v.color = color;
+        detail::shape_internal_visit_vertices(_internal, [&](auto& data) {
+            detail::shape_internal_set_vertex_color(data, color);
+        });
 
         update_color();
     }
@@ -1122,6 +1664,7 @@ namespace mousetrap
             return;
 
         _internal->is_visible = b;
+        _internal->version = detail::render_state_next_version();
     }
 
     bool Shape::get_is_visible() const
@@ -1137,21 +1680,8 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return Vector2f(0, 0);
 
-        static const auto negative_infinity = std::numeric_limits<float>::min();
-        static const auto positive_infinity = std::numeric_limits<float>::max();
-
-        Vector3f min = Vector3f(positive_infinity);
-        Vector3f max = Vector3f(negative_infinity);
-
-        for (auto& v : *_internal->vertices)
-        {
-            min.x = std::min(min.x, v.position.x);
-            min.y = std::min(min.y, v.position.y);
-            min.z = std::min(min.z, v.position.z);
-            max.x = std::max(max.x, v.position.x);
-            max.y = std::max(max.y, v.position.y);
-            max.z = std::max(max.z, v.position.z);
-        }
+        Vector3f min, max;
+        detail::shape_internal_get_bounds(_internal, min, max);
 
         return Vector3f(
         min.x + (max.x - min.x) / 2,
@@ -1166,14 +1696,14 @@ namespace mousetrap
             return;
 
         auto delta = position - get_centroid();
-        for (auto& v : *_internal->vertices)
-        {
-            v.position.x += delta.x;
-            v.position.y += delta.y;
-        }
+        detail::shape_internal_visit_vertices(_internal, [&](auto& data) {
+            auto position = detail::shape_internal_get_vertex_position(data);
+            position.x += delta.x;
+            position.y += delta.y;
+            detail::shape_internal_set_vertex_position(data, position);
+        });
 
         update_position();
-        update_data(true, false, false);
     }
 
     Rectangle Shape::get_bounding_box() const
@@ -1181,28 +1711,12 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return mousetrap::Rectangle{{0, 0}, {0, 0}};
 
-        float min_x = std::numeric_limits<float>::max();
-        float min_y = std::numeric_limits<float>::max();
-        float min_z = std::numeric_limits<float>::max();
-
-        float max_x = std::numeric_limits<float>::min();
-        float max_y = std::numeric_limits<float>::min();
-        float max_z = std::numeric_limits<float>::min();
-
-        for (auto& v : *_internal->vertices)
-        {
-            min_x = std::min(min_x, v.position.x);
-            min_y = std::min(min_y, v.position.y);
-            min_z = std::min(min_z, v.position.z);
-
-            max_x = std::max(max_x, v.position.x);
-            max_y = std::max(max_y, v.position.y);
-            max_z = std::max(max_z, v.position.z);
-        }
+        Vector3f min, max;
+        detail::shape_internal_get_bounds(_internal, min, max);
 
         return mousetrap::Rectangle{
-            {min_x, max_y},
-            {max_x - min_x, max_y - min_y}
+            {min.x, max.y},
+            {max.x - min.x, max.y - min.y}
         };
     }
 
@@ -1228,14 +1742,14 @@ namespace mousetrap
             return;
 
         auto delta = position - get_bounding_box().top_left;
-        for (auto& v : *_internal->vertices)
-        {
-            v.position.x += delta.x;
-            v.position.y += delta.y;
-        }
+        detail::shape_internal_visit_vertices(_internal, [&](auto& data) {
+            auto position = detail::shape_internal_get_vertex_position(data);
+            position.x += delta.x;
+            position.y += delta.y;
+            detail::shape_internal_set_vertex_position(data, position);
+        });
 
         update_position();
-        update_data(true, false, false);
     }
 
     void Shape::rotate(Angle angle, Vector2f origin)
@@ -1248,14 +1762,12 @@ namespace mousetrap
         transform.rotate(angle, origin);
         //transform.translate({origin.x, origin.y});
 
-        for (auto& v : *_internal->vertices)
-        {
-            auto pos = v.position;
-            v.position = transform.apply_to(pos);
-        }
+        detail::shape_internal_visit_vertices(_internal, [&](auto& data) {
+            auto pos = detail::shape_internal_get_vertex_position(data);
+            detail::shape_internal_set_vertex_position(data, transform.apply_to(pos));
+        });
 
         update_position();
-        update_data(true, false, false);
     }
 
     const TextureObject* Shape::get_texture() const
@@ -1271,7 +1783,31 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
+        if (texture == _internal->texture)
+            return;
+
         _internal->texture = texture;
+        _internal->version = detail::render_state_next_version();
+
+        for (auto& pair : *_internal->indexing_areas)
+            detail::render_area_internal_shape_texture_changed(pair.first, _internal);
+    }
+
+    void Shape::set_instance_buffer(const InstanceBuffer* instance_buffer)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->instance_buffer = instance_buffer;
+        _internal->version = detail::render_state_next_version();
+    }
+
+    const InstanceBuffer* Shape::get_instance_buffer() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return _internal->instance_buffer;
     }
 
     Shape::operator GObject*() const
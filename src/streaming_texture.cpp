@@ -0,0 +1,289 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/streaming_texture.hpp>
+#include <mousetrap/render_area.hpp>
+#include <mousetrap/log.hpp>
+
+#include <cstring>
+#include <sstream>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        DECLARE_NEW_TYPE(StreamingTextureInternal, streaming_texture_internal, STREAMING_TEXTURE_INTERNAL)
+
+        static void streaming_texture_internal_free_buffers(StreamingTextureInternal* self)
+        {
+            for (auto fence : *self->fences)
+                if (fence != nullptr)
+                    glDeleteSync(fence);
+
+            if (not self->pixel_buffers->empty())
+                glDeleteBuffers(self->pixel_buffers->size(), self->pixel_buffers->data());
+
+            std::fill(self->fences->begin(), self->fences->end(), nullptr);
+            std::fill(self->pixel_buffers->begin(), self->pixel_buffers->end(), 0);
+            self->buffer_size = 0;
+        }
+
+        static void streaming_texture_internal_finalize(GObject* object)
+        {
+            auto* self = MOUSETRAP_STREAMING_TEXTURE_INTERNAL(object);
+            G_OBJECT_CLASS(streaming_texture_internal_parent_class)->finalize(object);
+
+            if (detail::is_opengl_disabled())
+                return;
+
+            streaming_texture_internal_free_buffers(self);
+
+            delete self->pixel_buffers;
+            delete self->fences;
+        }
+
+        DEFINE_NEW_TYPE_TRIVIAL_INIT(StreamingTextureInternal, streaming_texture_internal, STREAMING_TEXTURE_INTERNAL)
+        DEFINE_NEW_TYPE_TRIVIAL_CLASS_INIT(StreamingTextureInternal, streaming_texture_internal, STREAMING_TEXTURE_INTERNAL)
+
+        static StreamingTextureInternal* streaming_texture_internal_new(uint64_t n_buffers)
+        {
+            auto* self = (StreamingTextureInternal*) g_object_new(streaming_texture_internal_get_type(), nullptr);
+            streaming_texture_internal_init(self);
+
+            if (detail::is_opengl_disabled())
+                return self;
+
+            self->pixel_buffers = new std::vector<GLNativeHandle>(std::max<uint64_t>(n_buffers, 1), 0);
+            self->fences = new std::vector<GLsync>(self->pixel_buffers->size(), nullptr);
+            self->next_buffer = 0;
+            self->buffer_size = 0;
+            self->is_immutable = false;
+
+            return self;
+        }
+    }
+
+    StreamingTexture::StreamingTexture(uint64_t n_buffers)
+        : Texture()
+    {
+        if (detail::is_opengl_disabled())
+        {
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = detail::streaming_texture_internal_new(n_buffers);
+        detail::attach_ref_to(Texture::operator GObject*(), _internal);
+        g_object_ref(_internal);
+    }
+
+    StreamingTexture::StreamingTexture(detail::StreamingTextureInternal* internal)
+    {
+        if (detail::is_opengl_disabled())
+        {
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = g_object_ref(internal);
+    }
+
+    StreamingTexture::~StreamingTexture()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        g_object_unref(_internal);
+    }
+
+    NativeObject StreamingTexture::get_internal() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return G_OBJECT(_internal);
+    }
+
+    void StreamingTexture::create(uint64_t width, uint64_t height)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        if (_internal->is_immutable)
+        {
+            log::critical("In StreamingTexture::create: Texture storage was already allocated, it cannot be resized", MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        auto* texture = (detail::TextureInternal*) Texture::operator GObject*();
+        detail::gl_state_bind_texture(0, texture->native_handle);
+
+        // immutable storage lets the driver skip validating the texture on every update
+        if (GLEW_VERSION_4_2 or GLEW_ARB_texture_storage)
+        {
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+            _internal->is_immutable = true;
+        }
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+        *texture->size = {width, height};
+
+        detail::streaming_texture_internal_free_buffers(_internal);
+
+        _internal->buffer_size = width * height * 4;
+        glGenBuffers(_internal->pixel_buffers->size(), _internal->pixel_buffers->data());
+
+        for (auto buffer : *_internal->pixel_buffers)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, _internal->buffer_size, nullptr, GL_STREAM_DRAW);
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        _internal->next_buffer = 0;
+    }
+
+    void StreamingTexture::create_from_image(const Image& image)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        // Texture::create_from_image would respecify the storage with glTexImage2D, which fails for immutable storage
+        if (_internal->is_immutable)
+        {
+            log::critical("In StreamingTexture::create_from_image: Texture storage was already allocated, it cannot be resized, use `StreamingTexture::push_frame` instead", MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        create(image.get_size().x, image.get_size().y);
+        push_frame(image);
+    }
+
+    bool StreamingTexture::create_from_file(const std::string& path)
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        auto image = Image();
+        auto out = image.create_from_file(path);
+
+        create_from_image(image);
+        return out;
+    }
+
+    void StreamingTexture::set_format(TextureFormat format)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        if (format != TextureFormat::RGBA8)
+        {
+            log::critical("In StreamingTexture::set_format: Streaming textures are always stored as TextureFormat::RGBA8, the format cannot be changed", MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        Texture::set_format(format);
+    }
+
+    void StreamingTexture::push_frame(const Image& image)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto size = get_size();
+        if (int64_t(image.get_size().x) != int64_t(size.x) or int64_t(image.get_size().y) != int64_t(size.y))
+        {
+            std::stringstream str;
+            str << "In StreamingTexture::push_frame: Image of size " << image.get_size().x << "x" << image.get_size().y << " does not match texture of size " << size.x << "x" << size.y;
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        auto* pixbuf = image.operator GdkPixbuf*();
+        push_frame(image.data(), gdk_pixbuf_get_byte_length(pixbuf), gdk_pixbuf_get_has_alpha(pixbuf) ? GL_RGBA : GL_RGB);
+    }
+
+    void StreamingTexture::push_frame(const void* data)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        push_frame(data, _internal->buffer_size, GL_RGBA);
+    }
+
+    void StreamingTexture::push_frame(const void* data, uint64_t n_bytes, GLenum format)
+    {
+        if (_internal->buffer_size == 0)
+        {
+            log::critical("In StreamingTexture::push_frame: Texture storage is not allocated, call `StreamingTexture::create` first", MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        auto i = _internal->next_buffer;
+        _internal->next_buffer = (i + 1) % _internal->pixel_buffers->size();
+
+        // only blocks if all buffers are still being transferred, which means the GPU is n_buffers frames behind
+        auto& fence = _internal->fences->at(i);
+        if (fence != nullptr)
+        {
+            static constexpr GLuint64 timeout_ns = 1000000000;
+            if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns) == GL_TIMEOUT_EXPIRED)
+                log::warning("In StreamingTexture::push_frame: Waiting for previous upload timed out", MOUSETRAP_DOMAIN);
+
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        n_bytes = std::min(n_bytes, _internal->buffer_size);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _internal->pixel_buffers->at(i));
+
+        // the fence guarantees the GPU is done reading from this buffer, so it can be mapped without synchronization
+        auto* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, n_bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (mapped == nullptr)
+            glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, n_bytes, data);
+        else
+        {
+            std::memcpy(mapped, data, n_bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        auto* texture = (detail::TextureInternal*) Texture::operator GObject*();
+        detail::gl_state_bind_texture(0, texture->native_handle);
+
+        // rows of pixbufs are padded to 4 bytes, which matches an unpack alignment of 4
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture->size->x, texture->size->y, format, GL_UNSIGNED_BYTE, nullptr);
+
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        texture->mipmap_dirty = true;
+        texture->version = detail::render_state_next_version();
+        detail::gl_statistics_count_upload(n_bytes);
+
+        // any other upload would otherwise read from this buffer instead of client memory
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    uint64_t StreamingTexture::get_n_buffers() const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return _internal->pixel_buffers->size();
+    }
+
+    StreamingTexture::operator GObject*() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return G_OBJECT(_internal);
+    }
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT
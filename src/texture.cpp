@@ -7,6 +7,10 @@
 #if MOUSETRAP_ENABLE_OPENGL_COMPONENT
 
 #include <iostream>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <sstream>
 #include <mousetrap/texture.hpp>
 #include <mousetrap/render_area.hpp>
 
@@ -26,8 +30,19 @@ namespace mousetrap
 
             delete self->size;
 
-            if (self->native_handle != 0)
+            for (auto& update : *self->pending_updates)
+                g_object_unref(update.pixbuf);
+
+            delete self->pending_updates;
+
+            // storage of render textures belongs to the pool
+            if (self->render_target_allocation != nullptr)
+                render_target_pool_release(self->render_target_allocation);
+            else if (self->native_handle != 0)
+            {
+                detail::gl_state_forget_texture(self->native_handle);
                 glDeleteTextures(1, &self->native_handle);
+            }
         }
 
         DEFINE_NEW_TYPE_TRIVIAL_INIT(TextureInternal, texture_internal, TEXTURE_INTERNAL)
@@ -47,10 +62,257 @@ namespace mousetrap
             self->native_handle = 0;
             self->wrap_mode = TextureWrapMode::REPEAT;
             self->scale_mode = TextureScaleMode::NEAREST;
+            self->format = TextureFormat::RGBA8;
+            self->anisotropy_level = 1;
+            self->sampler_id = 0;
+            self->mipmap_dirty = false;
+            self->version = render_state_next_version();
+            self->render_target_allocation = nullptr;
             self->size = new Vector2i(0, 0);
+            self->pending_updates = new std::vector<TextureRegionUpdate>();
 
             return self;
         }
+
+        void texture_internal_clear_updates(TextureInternal* self)
+        {
+            for (auto& update : *self->pending_updates)
+                g_object_unref(update.pixbuf);
+
+            self->pending_updates->clear();
+        }
+
+        void texture_internal_flush_updates(TextureInternal* self)
+        {
+            if (self->pending_updates->empty())
+                return;
+
+            gl_state_bind_texture(0, self->native_handle);
+
+            for (auto& update : *self->pending_updates)
+            {
+                // gdk pads rows to 4 bytes, so with a row length of the image width and an alignment of 4, GL steps through the pixbuf with the same stride
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glPixelStorei(GL_UNPACK_ROW_LENGTH, gdk_pixbuf_get_width(update.pixbuf));
+                glPixelStorei(GL_UNPACK_SKIP_PIXELS, update.src_offset.x);
+                glPixelStorei(GL_UNPACK_SKIP_ROWS, update.src_offset.y);
+
+                glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    update.dst_offset.x,
+                    update.dst_offset.y,
+                    update.size.x,
+                    update.size.y,
+                    gdk_pixbuf_get_has_alpha(update.pixbuf) ? GL_RGBA : GL_RGB,
+                    GL_UNSIGNED_BYTE,
+                    gdk_pixbuf_get_pixels(update.pixbuf)
+                );
+
+                gl_statistics_count_upload(update.size.x * update.size.y * gdk_pixbuf_get_n_channels(update.pixbuf));
+            }
+
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+            texture_internal_clear_updates(self);
+            self->mipmap_dirty = true;
+        }
+
+        GLenum texture_internal_resolve_format(TextureFormat format)
+        {
+            bool supported = true;
+            if (format == TextureFormat::COMPRESSED_RGBA_S3TC)
+                supported = GLEW_EXT_texture_compression_s3tc;
+            else if (format == TextureFormat::COMPRESSED_RGBA_BPTC)
+                supported = GLEW_VERSION_4_2 or GLEW_ARB_texture_compression_bptc;
+
+            if (not supported)
+            {
+                static bool warning_printed = false;
+                if (not warning_printed)
+                {
+                    log::warning("In Texture::create: Compressed texture format is not supported by the current OpenGL context, falling back to TextureFormat::RGBA8", MOUSETRAP_DOMAIN);
+                    warning_printed = true;
+                }
+
+                return GL_RGBA8;
+            }
+
+            return (GLenum) format;
+        }
+
+        struct TextureDownload
+        {
+            GLNativeHandle buffer;
+            GLsync fence;
+            Vector2i size;
+            std::function<void(const Image&)>* on_done;
+        };
+
+        static gboolean texture_internal_download_poll(void* data)
+        {
+            auto* download = (TextureDownload*) data;
+            detail::make_opengl_context_current();
+
+            // poll without blocking, if the GPU is not done yet, try again the next time the main loop is idle
+            auto status = glClientWaitSync(download->fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+                return G_SOURCE_CONTINUE;
+
+            auto image = Image();
+            image.create(download->size.x, download->size.y);
+
+            if (status == GL_WAIT_FAILED)
+                log::critical("In Texture::download_async: Waiting for transfer failed", MOUSETRAP_DOMAIN);
+            else
+            {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, download->buffer);
+                auto* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image.get_data_size(), GL_MAP_READ_BIT);
+                if (mapped != nullptr)
+                {
+                    std::memcpy(image.data(), mapped, image.get_data_size());
+                    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                }
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            }
+
+            glDeleteSync(download->fence);
+            glDeleteBuffers(1, &download->buffer);
+
+            (*download->on_done)(image);
+
+            delete download->on_done;
+            delete download;
+            return G_SOURCE_REMOVE;
+        }
+
+        // allocate pixel buffer and bind it as pack buffer, such that the next read only queues the transfer and returns immediately
+        static TextureDownload* texture_internal_download_begin(Vector2i size, std::function<void(const Image&)>* on_done)
+        {
+            if (size.x <= 0 or size.y <= 0)
+            {
+                log::critical("In Texture::download_async: Texture has size 0x0", MOUSETRAP_DOMAIN);
+                delete on_done;
+                return nullptr;
+            }
+
+            auto* download = new TextureDownload{0, nullptr, size, on_done};
+
+            glGenBuffers(1, &download->buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, download->buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size.x * size.y * 4, nullptr, GL_STREAM_READ);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            return download;
+        }
+
+        static void texture_internal_download_end(TextureDownload* download)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            download->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+
+            static constexpr guint poll_interval_ms = 4;
+            g_timeout_add(poll_interval_ms, texture_internal_download_poll, download);
+        }
+
+        void texture_internal_download_async(GLNativeHandle texture, Vector2i size, std::function<void(const Image&)>* on_done)
+        {
+            auto* download = texture_internal_download_begin(size, on_done);
+            if (download == nullptr)
+                return;
+
+            gl_state_bind_texture(0, texture);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            texture_internal_download_end(download);
+        }
+
+        void texture_internal_download_framebuffer_async(GLNativeHandle framebuffer, GLenum attachment, Vector2i size, std::function<void(const Image&)>* on_done)
+        {
+            auto* download = texture_internal_download_begin(size, on_done);
+            if (download == nullptr)
+                return;
+
+            texture_internal_read_framebuffer(framebuffer, attachment, size, nullptr);
+            texture_internal_download_end(download);
+        }
+
+        void texture_internal_read_framebuffer(GLNativeHandle framebuffer, GLenum attachment, Vector2i size, void* out)
+        {
+            GLint before = 0;
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &before);
+
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            glReadBuffer(attachment);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, out);
+
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, before);
+        }
+
+        bool texture_scale_mode_uses_mipmap(TextureScaleMode scale_mode)
+        {
+            return scale_mode == TextureScaleMode::NEAREST_MIPMAP or scale_mode == TextureScaleMode::LINEAR_MIPMAP or scale_mode == TextureScaleMode::TRILINEAR;
+        }
+
+        static float texture_internal_get_max_anisotropy()
+        {
+            static float max = -1;
+            if (max < 0)
+            {
+                max = 1;
+                if (GLEW_EXT_texture_filter_anisotropic or GLEW_ARB_texture_filter_anisotropic)
+                    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max);
+            }
+
+            return max;
+        }
+
+        GLNativeHandle texture_internal_get_sampler(TextureWrapMode wrap_mode, TextureScaleMode scale_mode, float anisotropy_level)
+        {
+            static auto samplers = std::map<std::tuple<TextureWrapMode, TextureScaleMode, float>, GLNativeHandle>();
+
+            anisotropy_level = glm::clamp(anisotropy_level, 1.f, texture_internal_get_max_anisotropy());
+
+            auto key = std::make_tuple(wrap_mode, scale_mode, anisotropy_level);
+            auto it = samplers.find(key);
+            if (it != samplers.end())
+                return it->second;
+
+            GLNativeHandle id = 0;
+            glGenSamplers(1, &id);
+
+            if (wrap_mode == TextureWrapMode::ZERO)
+            {
+                static float zero_border[] = {0.f, 0.f, 0.f, 0.f};
+                glSamplerParameterfv(id, GL_TEXTURE_BORDER_COLOR, zero_border);
+                glSamplerParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+                glSamplerParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            }
+            else if (wrap_mode == TextureWrapMode::ONE)
+            {
+                static float one_border[] = {1.f, 1.f, 1.f, 1.f};
+                glSamplerParameterfv(id, GL_TEXTURE_BORDER_COLOR, one_border);
+                glSamplerParameteri(id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+                glSamplerParameteri(id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            }
+            else
+            {
+                glSamplerParameteri(id, GL_TEXTURE_WRAP_S, (GLint) wrap_mode);
+                glSamplerParameteri(id, GL_TEXTURE_WRAP_T, (GLint) wrap_mode);
+            }
+
+            // magnification never uses the mip chain, so only the minification filter can be a mipmap filter
+            glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, (GLint) scale_mode);
+            glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, (scale_mode == TextureScaleMode::NEAREST or scale_mode == TextureScaleMode::NEAREST_MIPMAP) ? GL_NEAREST : GL_LINEAR);
+
+            if (anisotropy_level > 1)
+                glSamplerParameterf(id, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy_level);
+
+            samplers.insert({key, id});
+            return id;
+        }
     }
     
     Texture::Texture()
@@ -79,7 +341,7 @@ namespace mousetrap
 
         _internal->native_handle = handle;
 
-        glBindTexture(GL_TEXTURE_2D, handle);
+        detail::gl_state_bind_texture(0, handle);
 
         int width = 0;
         int height = 0;
@@ -121,13 +383,14 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glActiveTexture(GL_TEXTURE0 + 0);
-        glBindTexture(GL_TEXTURE_2D, _internal->native_handle);
+        detail::gl_state_bind_texture(0, _internal->native_handle);
+
+        detail::texture_internal_clear_updates(_internal);
 
         glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glTexImage2D(GL_TEXTURE_2D,
              0,
-             GL_RGBA16F,
+             detail::texture_internal_resolve_format(_internal->format),
              width,
              height,
              0,
@@ -137,6 +400,8 @@ namespace mousetrap
         );
 
         *_internal->size = {width, height};
+        _internal->mipmap_dirty = true;
+        _internal->version = detail::render_state_next_version();
     }
 
     bool Texture::create_from_file(const std::string& path)
@@ -190,18 +455,19 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glActiveTexture(GL_TEXTURE0 + 0);
-        glBindTexture(GL_TEXTURE_2D, _internal->native_handle);
+        detail::gl_state_bind_texture(0, _internal->native_handle);
 
         if (image.get_size().x == 0 or image.get_size().y == 0)
             log::critical(MOUSETRAP_DOMAIN, "In Texture::create_from_image: image has invalid size, make sure the image is initialized correctly before creating a texture");
 
+        detail::texture_internal_clear_updates(_internal);
+
         glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glPixelStorei(GL_PACK_ALIGNMENT, 4);
 
         glTexImage2D(GL_TEXTURE_2D,
              0,
-             GL_RGBA16F,
+             detail::texture_internal_resolve_format(_internal->format),
              image.get_size().x,
             image.get_size().y,
              0,
@@ -209,40 +475,125 @@ namespace mousetrap
              GL_UNSIGNED_BYTE,
              image.data()
         );
+        detail::gl_statistics_count_upload(image.get_data_size());
 
         *_internal->size = image.get_size();
+        _internal->mipmap_dirty = true;
+        _internal->version = detail::render_state_next_version();
     }
 
-    void Texture::bind(uint64_t texture_unit) const
+    void Texture::update_region(const Image& image, Vector2i src_offset, Vector2i dst_offset, Vector2ui size)
     {
         if (detail::is_opengl_disabled())
             return;
 
-        glActiveTexture(GL_TEXTURE0 + texture_unit);
-        glBindTexture(GL_TEXTURE_2D, _internal->native_handle);
+        auto image_size = image.get_size();
+        auto texture_size = *_internal->size;
 
-        if (_internal->wrap_mode == TextureWrapMode::ZERO)
+        if (src_offset.x < 0 or src_offset.y < 0 or src_offset.x + size.x > image_size.x or src_offset.y + size.y > image_size.y)
         {
-            static float zero_border[] = {0.f, 0.f, 0.f, 0.f};
-            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, zero_border);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            std::stringstream str;
+            str << "In Texture::update_region: Region of size " << size.x << "x" << size.y << " at " << src_offset.x << ", " << src_offset.y << " is out of bounds for an image of size " << image_size.x << "x" << image_size.y;
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return;
         }
-        else if (_internal->wrap_mode == TextureWrapMode::ONE)
+
+        if (dst_offset.x < 0 or dst_offset.y < 0 or int64_t(dst_offset.x) + int64_t(size.x) > int64_t(texture_size.x) or int64_t(dst_offset.y) + int64_t(size.y) > int64_t(texture_size.y))
         {
-            static float one_border[] = {1.f, 1.f, 1.f, 1.f};
-            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, one_border);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            std::stringstream str;
+            str << "In Texture::update_region: Region of size " << size.x << "x" << size.y << " at " << dst_offset.x << ", " << dst_offset.y << " is out of bounds for a texture of size " << texture_size.x << "x" << texture_size.y;
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return;
         }
-        else
+
+        if (size.x == 0 or size.y == 0)
+            return;
+
+        auto update = detail::TextureRegionUpdate{
+            image.operator GdkPixbuf*(),
+            src_offset,
+            dst_offset,
+            Vector2i(size.x, size.y)
+        };
+
+        auto area = [](const detail::TextureRegionUpdate& x) -> int64_t {
+            return int64_t(x.size.x) * int64_t(x.size.y);
+        };
+
+        // number of pixels covered by both regions, in image coordinates
+        auto intersection_area = [](const detail::TextureRegionUpdate& a, const detail::TextureRegionUpdate& b) -> int64_t {
+            auto min = glm::max(a.src_offset, b.src_offset);
+            auto max = glm::min(a.src_offset + a.size, b.src_offset + b.size);
+            if (max.x <= min.x or max.y <= min.y)
+                return 0;
+
+            return int64_t(max.x - min.x) * int64_t(max.y - min.y);
+        };
+
+        auto overlaps = [](const detail::TextureRegionUpdate& a, const detail::TextureRegionUpdate& b) -> bool {
+            return a.dst_offset.x < b.dst_offset.x + b.size.x and b.dst_offset.x < a.dst_offset.x + a.size.x
+               and a.dst_offset.y < b.dst_offset.y + b.size.y and b.dst_offset.y < a.dst_offset.y + a.size.y;
+        };
+
+        auto& pending = *_internal->pending_updates;
+
+        // merge with a queued region of the same image and mapping if their union is exactly a rectangle, such that no pixel outside of both is uploaded
+        // the merged region is uploaded at the position of the older one, which is only correct if no region queued after it writes to the same pixels
+        for (uint64_t i = 0; i < pending.size(); ++i)
         {
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, (GLint) _internal->wrap_mode);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, (GLint) _internal->wrap_mode);
+            auto& other = pending.at(i);
+            if (other.pixbuf != update.pixbuf or other.dst_offset - other.src_offset != update.dst_offset - update.src_offset)
+                continue;
+
+            auto min = glm::min(other.src_offset, update.src_offset);
+            auto max = glm::max(other.src_offset + other.size, update.src_offset + update.size);
+            auto merged = detail::TextureRegionUpdate{update.pixbuf, min, min + (update.dst_offset - update.src_offset), max - min};
+
+            if (area(merged) != area(other) + area(update) - intersection_area(other, update))
+                continue;
+
+            bool overwritten = false;
+            for (uint64_t j = i + 1; j < pending.size(); ++j)
+            {
+                if (overlaps(pending.at(j), merged))
+                {
+                    overwritten = true;
+                    break;
+                }
+            }
+
+            if (overwritten)
+                continue;
+
+            // same pixbuf, so the reference held by the queued region carries over
+            other = merged;
+            _internal->version = detail::render_state_next_version();
+            return;
         }
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (GLint) _internal->scale_mode);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (GLint) _internal->scale_mode);
+        g_object_ref(update.pixbuf);
+        pending.push_back(update);
+        _internal->version = detail::render_state_next_version();
+    }
+
+    void Texture::bind(uint64_t texture_unit) const
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::texture_internal_flush_updates(_internal);
+
+        if (_internal->sampler_id == 0)
+            _internal->sampler_id = detail::texture_internal_get_sampler(_internal->wrap_mode, _internal->scale_mode, _internal->anisotropy_level);
+
+        detail::gl_state_bind_texture(texture_unit, _internal->native_handle);
+
+        if (_internal->mipmap_dirty and detail::texture_scale_mode_uses_mipmap(_internal->scale_mode))
+        {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            _internal->mipmap_dirty = false;
+        }
+        detail::gl_state_bind_sampler(texture_unit, _internal->sampler_id);
     }
 
     void Texture::bind() const
@@ -258,7 +609,15 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return;
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+        detail::gl_state_bind_texture(0, 0);
+    }
+
+    uint64_t Texture::get_version() const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return _internal->version;
     }
 
     void Texture::set_wrap_mode(TextureWrapMode wrap_mode)
@@ -267,6 +626,8 @@ namespace mousetrap
             return;
 
         _internal->wrap_mode = wrap_mode;
+        _internal->sampler_id = 0;
+        _internal->version = detail::render_state_next_version();
     }
 
     TextureWrapMode Texture::get_wrap_mode()
@@ -277,6 +638,51 @@ namespace mousetrap
         return _internal->wrap_mode;
     }
 
+    void Texture::generate_mipmap()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        detail::texture_internal_flush_updates(_internal);
+        detail::gl_state_bind_texture(0, _internal->native_handle);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        _internal->mipmap_dirty = false;
+    }
+
+    void Texture::set_anisotropy_level(float level)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->anisotropy_level = glm::max(level, 1.f);
+        _internal->sampler_id = 0;
+        _internal->version = detail::render_state_next_version();
+    }
+
+    float Texture::get_anisotropy_level() const
+    {
+        if (detail::is_opengl_disabled())
+            return 1;
+
+        return _internal->anisotropy_level;
+    }
+
+    void Texture::set_format(TextureFormat format)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        _internal->format = format;
+    }
+
+    TextureFormat Texture::get_format() const
+    {
+        if (detail::is_opengl_disabled())
+            return TextureFormat::RGBA8;
+
+        return _internal->format;
+    }
+
     Vector2i Texture::get_size() const
     {
         if (detail::is_opengl_disabled())
@@ -299,6 +705,8 @@ namespace mousetrap
             return;
 
         _internal->scale_mode = mode;
+        _internal->sampler_id = 0;
+        _internal->version = detail::render_state_next_version();
     }
 
     TextureScaleMode Texture::get_scale_mode()
@@ -314,12 +722,13 @@ namespace mousetrap
         if (detail::is_opengl_disabled())
             return Image();
 
+        detail::texture_internal_flush_updates(_internal);
+
         auto out = Image();
         out.create(_internal->size->x, _internal->size->y);
 
-        glBindTexture(GL_TEXTURE_2D, _internal->native_handle);
+        detail::gl_state_bind_texture(0, _internal->native_handle);
         glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, out.data());
-        glBindTexture(GL_TEXTURE_2D, 0);
 
         return out;
     }
@@ -0,0 +1,450 @@
+//
+// Copyright (c) Clemens Cords (mail@clemens-cords.com), created 10/17/26
+//
+
+#include <mousetrap/gl_common.hpp>
+#if MOUSETRAP_ENABLE_OPENGL_COMPONENT
+
+#include <mousetrap/texture_atlas.hpp>
+#include <mousetrap/render_area.hpp>
+#include <mousetrap/log.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+namespace mousetrap
+{
+    namespace detail
+    {
+        DECLARE_NEW_TYPE(TextureAtlasInternal, texture_atlas_internal, TEXTURE_ATLAS_INTERNAL)
+
+        static void texture_atlas_internal_free_page(TextureAtlasPage& page)
+        {
+            delete page.texture;
+            delete page.image;
+            delete page.skyline;
+        }
+
+        static void texture_atlas_internal_finalize(GObject* object)
+        {
+            auto* self = MOUSETRAP_TEXTURE_ATLAS_INTERNAL(object);
+            G_OBJECT_CLASS(texture_atlas_internal_parent_class)->finalize(object);
+
+            if (detail::is_opengl_disabled())
+                return;
+
+            for (auto& page : *self->pages)
+                texture_atlas_internal_free_page(page);
+
+            delete self->pages;
+            delete self->entries;
+        }
+
+        DEFINE_NEW_TYPE_TRIVIAL_INIT(TextureAtlasInternal, texture_atlas_internal, TEXTURE_ATLAS_INTERNAL)
+        DEFINE_NEW_TYPE_TRIVIAL_CLASS_INIT(TextureAtlasInternal, texture_atlas_internal, TEXTURE_ATLAS_INTERNAL)
+
+        static TextureAtlasInternal* texture_atlas_internal_new(Vector2ui page_size, uint64_t padding)
+        {
+            auto* self = (TextureAtlasInternal*) g_object_new(texture_atlas_internal_get_type(), nullptr);
+            texture_atlas_internal_init(self);
+
+            if (detail::is_opengl_disabled())
+                return self;
+
+            self->pages = new std::vector<TextureAtlasPage>();
+            self->entries = new std::map<uint64_t, TextureAtlasEntry>();
+            self->next_id = 1;
+            self->page_size = page_size;
+            self->padding = padding;
+
+            return self;
+        }
+
+        // page without a texture, the caller is responsible for allocating it
+        static TextureAtlasPage texture_atlas_internal_new_page(TextureAtlasInternal* self)
+        {
+            auto out = TextureAtlasPage();
+            out.texture = nullptr;
+            out.image = new Image(self->page_size.x, self->page_size.y, RGBA(0, 0, 0, 0));
+            out.skyline = new std::vector<TextureAtlasSkylineNode>{{0, 0, self->page_size.x}};
+            out.allocated_area = 0;
+            out.used_area = 0;
+            return out;
+        }
+
+        // check if a rectangle fits with its left edge at the start of skyline node i, if yes, y is the lowest position it can be placed at
+        static bool texture_atlas_internal_fits(const std::vector<TextureAtlasSkylineNode>& skyline, uint64_t i, uint64_t width, uint64_t height, Vector2ui page_size, uint64_t& y)
+        {
+            if (skyline.at(i).x + width > page_size.x)
+                return false;
+
+            y = 0;
+            uint64_t remaining = width;
+            while (remaining > 0)
+            {
+                if (i >= skyline.size())
+                    return false;
+
+                y = std::max(y, skyline.at(i).y);
+                if (y + height > page_size.y)
+                    return false;
+
+                if (skyline.at(i).width >= remaining)
+                    break;
+
+                remaining -= skyline.at(i).width;
+                i += 1;
+            }
+
+            return true;
+        }
+
+        // bottom-left skyline packing: place the rectangle such that its bottom edge is as high as possible, which keeps the skyline flat
+        static bool texture_atlas_internal_pack(TextureAtlasInternal* self, TextureAtlasPage& page, uint64_t width, uint64_t height, Vector2ui& position)
+        {
+            auto& skyline = *page.skyline;
+
+            bool found = false;
+            uint64_t best_index = 0;
+            uint64_t best_bottom = std::numeric_limits<uint64_t>::max();
+            uint64_t best_width = std::numeric_limits<uint64_t>::max();
+
+            for (uint64_t i = 0; i < skyline.size(); ++i)
+            {
+                uint64_t y = 0;
+                if (not texture_atlas_internal_fits(skyline, i, width, height, self->page_size, y))
+                    continue;
+
+                auto bottom = y + height;
+                if (bottom < best_bottom or (bottom == best_bottom and skyline.at(i).width < best_width))
+                {
+                    found = true;
+                    best_index = i;
+                    best_bottom = bottom;
+                    best_width = skyline.at(i).width;
+                    position = {skyline.at(i).x, y};
+                }
+            }
+
+            if (not found)
+                return false;
+
+            skyline.insert(skyline.begin() + best_index, TextureAtlasSkylineNode{position.x, position.y + height, width});
+
+            // shrink or remove nodes now covered by the new one
+            for (uint64_t i = best_index + 1; i < skyline.size();)
+            {
+                auto& previous = skyline.at(i - 1);
+                auto& node = skyline.at(i);
+
+                auto previous_end = previous.x + previous.width;
+                if (node.x >= previous_end)
+                    break;
+
+                auto shrink = previous_end - node.x;
+                if (node.width <= shrink)
+                {
+                    skyline.erase(skyline.begin() + i);
+                    continue;
+                }
+
+                node.x += shrink;
+                node.width -= shrink;
+                break;
+            }
+
+            // merge neighbours at the same height
+            for (uint64_t i = 0; i + 1 < skyline.size();)
+            {
+                if (skyline.at(i).y == skyline.at(i + 1).y)
+                {
+                    skyline.at(i).width += skyline.at(i + 1).width;
+                    skyline.erase(skyline.begin() + i + 1);
+                }
+                else
+                    i += 1;
+            }
+
+            page.allocated_area += width * height;
+            return true;
+        }
+    }
+
+    TextureAtlas::TextureAtlas(uint64_t page_width, uint64_t page_height, uint64_t padding)
+    {
+        if (detail::is_opengl_disabled())
+        {
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = detail::texture_atlas_internal_new(Vector2ui(page_width, page_height), padding);
+    }
+
+    TextureAtlas::TextureAtlas(detail::TextureAtlasInternal* internal)
+    {
+        if (detail::is_opengl_disabled())
+        {
+            _internal = nullptr;
+            return;
+        }
+
+        _internal = g_object_ref(internal);
+    }
+
+    TextureAtlas::~TextureAtlas()
+    {
+        if (not detail::is_opengl_disabled())
+            g_object_unref(_internal);
+    }
+
+    NativeObject TextureAtlas::get_internal() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return G_OBJECT(_internal);
+    }
+
+    TextureAtlas::operator NativeObject() const
+    {
+        if (detail::is_opengl_disabled())
+            return nullptr;
+
+        return G_OBJECT(_internal);
+    }
+
+    uint64_t TextureAtlas::add_image(const Image& image)
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        auto size = image.get_size();
+        auto width = size.x + _internal->padding;
+        auto height = size.y + _internal->padding;
+
+        if (size.x == 0 or size.y == 0)
+        {
+            log::critical("In TextureAtlas::add_image: Image has invalid size", MOUSETRAP_DOMAIN);
+            return 0;
+        }
+
+        if (width > _internal->page_size.x or height > _internal->page_size.y)
+        {
+            std::stringstream str;
+            str << "In TextureAtlas::add_image: Image of size " << size.x << "x" << size.y << " does not fit into a page of size " << _internal->page_size.x << "x" << _internal->page_size.y;
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return 0;
+        }
+
+        auto try_pack = [&](uint64_t& page_index, Vector2ui& position) -> bool {
+            for (page_index = 0; page_index < _internal->pages->size(); ++page_index)
+                if (detail::texture_atlas_internal_pack(_internal, _internal->pages->at(page_index), width, height, position))
+                    return true;
+
+            return false;
+        };
+
+        uint64_t page_index = 0;
+        auto position = Vector2ui(0, 0);
+
+        // never repack here, that would move images and free pages the caller may still reference
+        if (not try_pack(page_index, position))
+        {
+            auto page = detail::texture_atlas_internal_new_page(_internal);
+            page.texture = new Texture();
+            page.texture->create_from_image(*page.image);
+            _internal->pages->push_back(page);
+
+            page_index = _internal->pages->size() - 1;
+            detail::texture_atlas_internal_pack(_internal, _internal->pages->back(), width, height, position);
+        }
+
+        auto& page = _internal->pages->at(page_index);
+        gdk_pixbuf_copy_area(image.operator GdkPixbuf*(), 0, 0, size.x, size.y, page.image->operator GdkPixbuf*(), position.x, position.y);
+        page.texture->update_region(*page.image, Vector2i(position.x, position.y), Vector2i(position.x, position.y), size);
+        page.used_area += width * height;
+
+        auto id = _internal->next_id++;
+        _internal->entries->insert({id, detail::TextureAtlasEntry{page_index, position, size}});
+        return id;
+    }
+
+    void TextureAtlas::remove_image(uint64_t id)
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        auto it = _internal->entries->find(id);
+        if (it == _internal->entries->end())
+        {
+            std::stringstream str;
+            str << "In TextureAtlas::remove_image: No image with id " << id;
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return;
+        }
+
+        auto& entry = it->second;
+        _internal->pages->at(entry.page).used_area -= (entry.size.x + _internal->padding) * (entry.size.y + _internal->padding);
+        _internal->entries->erase(it);
+    }
+
+    bool TextureAtlas::has_image(uint64_t id) const
+    {
+        if (detail::is_opengl_disabled())
+            return false;
+
+        return _internal->entries->find(id) != _internal->entries->end();
+    }
+
+    Rectangle TextureAtlas::get_texture_rectangle(uint64_t id) const
+    {
+        if (detail::is_opengl_disabled())
+            return Rectangle{{0, 0}, {0, 0}};
+
+        auto it = _internal->entries->find(id);
+        if (it == _internal->entries->end())
+        {
+            std::stringstream str;
+            str << "In TextureAtlas::get_texture_rectangle: No image with id " << id;
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return Rectangle{{0, 0}, {0, 0}};
+        }
+
+        auto& entry = it->second;
+        auto page_size = Vector2f(_internal->page_size.x, _internal->page_size.y);
+        return Rectangle{
+            Vector2f(entry.position.x, entry.position.y) / page_size,
+            Vector2f(entry.size.x, entry.size.y) / page_size
+        };
+    }
+
+    uint64_t TextureAtlas::get_page_index(uint64_t id) const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        auto it = _internal->entries->find(id);
+        if (it == _internal->entries->end())
+        {
+            std::stringstream str;
+            str << "In TextureAtlas::get_page_index: No image with id " << id;
+            log::critical(str.str(), MOUSETRAP_DOMAIN);
+            return 0;
+        }
+
+        return it->second.page;
+    }
+
+    Texture& TextureAtlas::get_page(uint64_t page_index) const
+    {
+        static Texture* invalid = nullptr;
+
+        if (detail::is_opengl_disabled() or page_index >= _internal->pages->size())
+        {
+            if (not detail::is_opengl_disabled())
+            {
+                std::stringstream str;
+                str << "In TextureAtlas::get_page: Index " << page_index << " out of bounds for an atlas with " << _internal->pages->size() << " pages";
+                log::critical(str.str(), MOUSETRAP_DOMAIN);
+            }
+
+            if (invalid == nullptr)
+                invalid = new Texture();
+
+            return *invalid;
+        }
+
+        return *_internal->pages->at(page_index).texture;
+    }
+
+    uint64_t TextureAtlas::get_n_pages() const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return _internal->pages->size();
+    }
+
+    uint64_t TextureAtlas::get_n_images() const
+    {
+        if (detail::is_opengl_disabled())
+            return 0;
+
+        return _internal->entries->size();
+    }
+
+    void TextureAtlas::defragment()
+    {
+        if (detail::is_opengl_disabled())
+            return;
+
+        // packing tallest images first leaves the least gaps below the skyline
+        auto order = std::vector<detail::TextureAtlasEntry*>();
+        order.reserve(_internal->entries->size());
+        for (auto& pair : *_internal->entries)
+            order.push_back(&pair.second);
+
+        std::stable_sort(order.begin(), order.end(), [](detail::TextureAtlasEntry* a, detail::TextureAtlasEntry* b){
+            return a->size.y > b->size.y or (a->size.y == b->size.y and a->size.x > b->size.x);
+        });
+
+        auto old_pages = *_internal->pages;
+        auto new_pages = std::vector<detail::TextureAtlasPage>();
+
+        for (auto* entry : order)
+        {
+            auto width = entry->size.x + _internal->padding;
+            auto height = entry->size.y + _internal->padding;
+
+            auto position = Vector2ui(0, 0);
+            uint64_t page_index = 0;
+            bool packed = false;
+            for (page_index = 0; page_index < new_pages.size(); ++page_index)
+            {
+                if (detail::texture_atlas_internal_pack(_internal, new_pages.at(page_index), width, height, position))
+                {
+                    packed = true;
+                    break;
+                }
+            }
+
+            if (not packed)
+            {
+                new_pages.push_back(detail::texture_atlas_internal_new_page(_internal));
+                page_index = new_pages.size() - 1;
+                detail::texture_atlas_internal_pack(_internal, new_pages.back(), width, height, position);
+            }
+
+            auto& page = new_pages.at(page_index);
+            gdk_pixbuf_copy_area(old_pages.at(entry->page).image->operator GdkPixbuf*(), entry->position.x, entry->position.y, entry->size.x, entry->size.y, page.image->operator GdkPixbuf*(), position.x, position.y);
+            page.used_area += width * height;
+
+            entry->page = page_index;
+            entry->position = position;
+        }
+
+        // reuse existing textures, such that references returned by get_page stay valid
+        for (uint64_t i = 0; i < new_pages.size(); ++i)
+        {
+            auto& page = new_pages.at(i);
+            if (i < old_pages.size())
+            {
+                page.texture = old_pages.at(i).texture;
+                old_pages.at(i).texture = nullptr;
+            }
+            else
+                page.texture = new Texture();
+
+            page.texture->create_from_image(*page.image);
+        }
+
+        for (auto& page : old_pages)
+            detail::texture_atlas_internal_free_page(page);
+
+        *_internal->pages = new_pages;
+    }
+}
+
+#endif // MOUSETRAP_ENABLE_OPENGL_COMPONENT